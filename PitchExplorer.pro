@@ -2,11 +2,14 @@ QT += core gui multimediawidgets
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets printsupport
 
-CONFIG += c++11
+CONFIG += c++17
 
 # Uncomment to compile for Windows 64bit platform
 #CONFIG += win64
 
+# Uncomment to analyze in double instead of single precision (links fftw3 instead of fftw3f)
+#CONFIG += double_precision
+
 # The following define makes your compiler emit warnings if you use
 # any Qt feature that has been marked deprecated (the exact warnings
 # depend on your compiler). Please consult the documentation of the
@@ -23,22 +26,48 @@ TARGET = PitchExplorer
 INCLUDEPATH += extra/
 
 SOURCES += \
+    src/audioCache.cpp \
+    src/colorMapScroll.cpp \
+    src/compactMatrix.cpp \
+    src/dataFile.cpp \
+    src/fftPlanner.cpp \
+    src/filterBank.cpp \
     src/fourier.cpp \
     src/hurst.cpp \
     src/kmeans.cpp \
+    src/liveAnalyzer.cpp \
     src/main.cpp \
     src/mainWindow.cpp \
     src/pca.cpp \
+    src/pitch.cpp \
+    src/progress.cpp \
+    src/spectralFeatures.cpp \
+    src/waveFormPlottable.cpp \
     extra/fftw3.h \
     extra/flowLayout.cpp \
     extra/qcustomplot.cpp
 
 HEADERS += \
+    src/audioCache.h \
+    src/colorMapScroll.h \
+    src/compactMatrix.h \
+    src/dataFile.h \
+    src/fftPlanner.h \
+    src/filterBank.h \
     src/fourier.h \
     src/hurst.h \
     src/kmeans.h \
+    src/laneSum.h \
+    src/liveAnalyzer.h \
     src/mainWindow.h \
+    src/matrix.h \
+    src/parallel.h \
     src/pca.h \
+    src/pitch.h \
+    src/precision.h \
+    src/progress.h \
+    src/spectralFeatures.h \
+    src/waveFormPlottable.h \
     extra/dr_flac.h \
     extra/dr_mp3.h \
     extra/dr_wav.h \
@@ -47,10 +76,17 @@ HEADERS += \
     extra/miniaudio.h \
     extra/qcustomplot.h
 
+double_precision {
+    DEFINES += DOUBLE_PRECISION
+    FFTW_LIB = fftw3
+} else {
+    FFTW_LIB = fftw3f
+}
+
 win64 {
-    LIBS += "$$PWD/extra/libfftw3-3.dll" -lm
+    LIBS += "$$PWD/extra/lib$${FFTW_LIB}-3.dll" -lm
 } else {
-    LIBS += -lfftw3 -lm -ldl -lpthread
+    LIBS += -l$${FFTW_LIB} -lm -ldl -lpthread
 }
 
 QMAKE_CXXFLAGS_RELEASE += -O3
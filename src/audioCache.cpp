@@ -0,0 +1,133 @@
+#include "audioCache.h"
+#include "precision.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <algorithm>
+
+const char AudioCache::suffix[] = ".pxd";
+
+QString AudioCache::directory()
+{
+    QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/audio";
+    QDir().mkpath(path);
+    return path;
+}
+
+QString AudioCache::entryPath(const QString &filePath, bool keepChannels, int sampleRate)
+{
+    QFile file(filePath);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return QString();
+    }
+
+    QFileInfo info(file);
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    hash.addData(QString("%1|%2|%3|%4|%5|%6|%7|")
+                 .arg(version)
+                 .arg(info.absoluteFilePath())
+                 .arg(info.lastModified().toMSecsSinceEpoch())
+                 .arg(info.size())
+                 .arg(keepChannels)
+                 .arg(sampleRate)
+                 .arg(sizeof(Real))
+                 .toUtf8());
+
+    // Content changes that keep the modification time and size are caught when they touch either end
+
+    QByteArray head = file.read(sampleBytes);
+
+    if (head.size() != std::min(sampleBytes, info.size()))
+    {
+        return QString();
+    }
+
+    hash.addData(head);
+
+    if (info.size() > sampleBytes)
+    {
+        qint64 tailStart = std::max(sampleBytes, info.size() - sampleBytes);
+
+        if (!file.seek(tailStart))
+        {
+            return QString();
+        }
+
+        QByteArray tail = file.read(info.size() - tailStart);
+
+        if (tail.size() != info.size() - tailStart)
+        {
+            return QString();
+        }
+
+        hash.addData(tail);
+    }
+
+    return directory() + "/" + QString::fromLatin1(hash.result().toHex()) + suffix;
+}
+
+void AudioCache::touch(const QString &entryPath)
+{
+    QFile file(entryPath);
+
+    if (file.open(QIODevice::ReadWrite))
+    {
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+}
+
+void AudioCache::evict(qint64 maxBytes)
+{
+    // Oldest entries go first until the cache fits
+
+    QFileInfoList entries = QDir(directory()).entryInfoList({ QString("*") + suffix }, QDir::Files, QDir::Time | QDir::Reversed);
+
+    qint64 total = 0;
+
+    for (const QFileInfo &entry : entries)
+    {
+        total += entry.size();
+    }
+
+    for (const QFileInfo &entry : entries)
+    {
+        if (total <= maxBytes)
+        {
+            break;
+        }
+
+        if (QFile::remove(entry.absoluteFilePath()))
+        {
+            total -= entry.size();
+        }
+    }
+}
+
+qint64 AudioCache::size()
+{
+    qint64 total = 0;
+
+    for (const QFileInfo &entry : QDir(directory()).entryInfoList({ QString("*") + suffix }, QDir::Files))
+    {
+        total += entry.size();
+    }
+
+    return total;
+}
+
+int AudioCache::entryCount()
+{
+    return QDir(directory()).entryList({ QString("*") + suffix }, QDir::Files).size();
+}
+
+void AudioCache::clear()
+{
+    evict(0);
+}
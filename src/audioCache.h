@@ -0,0 +1,29 @@
+#ifndef AUDIOCACHE_H
+#define AUDIOCACHE_H
+
+#include <QString>
+#include <QtGlobal>
+
+// On-disk cache of decoded audio, stored as binary data files so that a hit is a memory mapping.
+// Entries are named after a hash of the source file's path, modification time and size, of its first and last
+// megabyte, and of the decoding options. Sampling the content keeps a lookup cheap for files of any length.
+// Eviction is least recently used first, a hit refreshes the entry's modification time.
+
+class AudioCache
+{
+public:
+    static QString directory();
+    static QString entryPath(const QString &filePath, bool keepChannels, int sampleRate);
+    static void touch(const QString &entryPath);
+    static void evict(qint64 maxBytes);
+    static qint64 size();
+    static int entryCount();
+    static void clear();
+
+private:
+    static const char suffix[];
+    static const quint32 version = 2;
+    static const qint64 sampleBytes = 1 << 20;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#include "colorMapScroll.h"
+#include <algorithm>
+
+void scrollColumns(QCPColorMapData *data, int count)
+{
+    int nx = data->keySize();
+    int ny = data->valueSize();
+
+    if (count <= 0 || data->isEmpty())
+    {
+        return;
+    }
+
+    count = std::min(count, nx);
+
+    for (int yIndex = 0; yIndex < ny; yIndex++)
+    {
+        for (int xIndex = count; xIndex < nx; xIndex++)
+        {
+            data->setCell(xIndex - count, yIndex, data->cell(xIndex, yIndex));
+        }
+
+        for (int xIndex = nx - count; xIndex < nx; xIndex++)
+        {
+            data->setCell(xIndex, yIndex, 0);
+        }
+    }
+}
@@ -0,0 +1,13 @@
+#ifndef COLORMAPSCROLL_H
+#define COLORMAPSCROLL_H
+
+#include "qcustomplot.h"
+
+// Scrolling of color map cells, for a spectrogram fed column by column as live input arrives.
+// Columns move towards lower keys within the existing cells, so that a refresh writes only its new columns
+// instead of resizing and refilling the whole map.
+
+// Moves every column of data count cells towards lower keys, the last count columns are zeroed for new data
+void scrollColumns(QCPColorMapData *data, int count);
+
+#endif
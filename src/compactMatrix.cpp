@@ -0,0 +1,261 @@
+#include "compactMatrix.h"
+#include <QFloat16>
+#include <algorithm>
+#include <cmath>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Values converted at once between half and single precision, on the stack
+
+static const int chunk = 64;
+
+CompactMatrix::CompactMatrix()
+{
+    storageFormat = Full;
+    nRows = 0;
+    nColumns = 0;
+    rowBytes = 0;
+}
+
+CompactMatrix::CompactMatrix(Format format, int rows, int columns)
+{
+    storageFormat = format;
+    nRows = rows;
+    nColumns = columns;
+    rowBytes = 0;
+
+    if (format == Full)
+    {
+        full = Matrix<Real>(rows, columns);
+        return;
+    }
+
+    // Rows padded to whole cache lines, as in Matrix
+
+    int alignment = Matrix<Real>::alignment;
+
+    rowBytes = (columns * elementBytes(format) + alignment - 1) / alignment * alignment;
+
+    size_t nBytes = static_cast<size_t>(rows) * static_cast<size_t>(rowBytes);
+
+    if (nBytes > 0)
+    {
+        quint8 *data = static_cast<quint8*>(::operator new(nBytes, std::align_val_t(alignment)));
+        std::fill(data, data + nBytes, static_cast<quint8>(0));
+
+        codes = std::shared_ptr<quint8>(data, [alignment](quint8 *p){ ::operator delete(p, std::align_val_t(alignment)); });
+        scales = std::shared_ptr<float>(new float[static_cast<size_t>(rows)](), std::default_delete<float[]>());
+    }
+}
+
+CompactMatrix::CompactMatrix(const Matrix<Real> &matrix)
+{
+    storageFormat = Full;
+    nRows = matrix.rows();
+    nColumns = matrix.columns();
+    rowBytes = 0;
+    full = matrix;
+}
+
+qint64 CompactMatrix::bytes() const
+{
+    if (storageFormat == Full)
+    {
+        return static_cast<qint64>(full.rows()) * full.stride() * static_cast<qint64>(sizeof(Real));
+    }
+
+    return static_cast<qint64>(nRows) * (rowBytes + static_cast<qint64>(sizeof(float)));
+}
+
+void CompactMatrix::clear()
+{
+    storageFormat = Full;
+    nRows = 0;
+    nColumns = 0;
+    rowBytes = 0;
+    full.clear();
+    codes.reset();
+    scales.reset();
+}
+
+int CompactMatrix::elementBytes(Format format)
+{
+    return format == Log8 ? 1 : format == Full ? static_cast<int>(sizeof(Real)) : 2;
+}
+
+int CompactMatrix::maxCode(Format format)
+{
+    return format == Log8 ? 255 : 65535;
+}
+
+double CompactMatrix::octaves(Format format)
+{
+    return format == Log8 ? 16 : 32;
+}
+
+std::vector<float> CompactMatrix::buildLogTable(Format format)
+{
+    // Value of each code relative to the row maximum: zero, then from the floor up to one in equal steps of log2
+
+    int top = maxCode(format);
+    double octavesPerStep = octaves(format) / (top - 1);
+
+    std::vector<float> table(static_cast<size_t>(top) + 1);
+
+    table[0] = 0;
+
+    for (int code = 1; code <= top; code++)
+    {
+        table[static_cast<size_t>(code)] = static_cast<float>(exp2((code - top) * octavesPerStep));
+    }
+
+    return table;
+}
+
+const float *CompactMatrix::logTable(Format format)
+{
+    static const std::vector<float> table8 = buildLogTable(Log8);
+    static const std::vector<float> table16 = buildLogTable(Log16);
+
+    return format == Log8 ? table8.data() : table16.data();
+}
+
+void CompactMatrix::encodeRow(int i, const Real *values)
+{
+    if (storageFormat == Full)
+    {
+        std::copy(values, values + nColumns, full.mutableRow(i));
+        return;
+    }
+
+    float maximum = 0;
+
+    for (int j = 0; j < nColumns; j++)
+    {
+        maximum = std::max(maximum, static_cast<float>(values[j]));
+    }
+
+    scales.get()[i] = maximum;
+
+    quint8 *rowData = codes.get() + static_cast<qint64>(i) * rowBytes;
+
+    if (maximum <= 0)
+    {
+        std::fill(rowData, rowData + rowBytes, static_cast<quint8>(0));
+        return;
+    }
+
+    float inverse = 1.0f / maximum;
+
+    if (storageFormat == Float16)
+    {
+        qfloat16 *halves = reinterpret_cast<qfloat16*>(rowData);
+        float relative[chunk];
+
+        for (int j = 0; j < nColumns; j += chunk)
+        {
+            int n = std::min(chunk, nColumns - j);
+
+            for (int k = 0; k < n; k++)
+            {
+                relative[k] = static_cast<float>(values[j + k]) * inverse;
+            }
+
+            qFloatToFloat16(halves + j, relative, n);
+        }
+
+        return;
+    }
+
+    // Nearest code on the log2 grid, values under the floor are zero
+
+    int top = maxCode(storageFormat);
+    double stepsPerOctave = (top - 1) / octaves(storageFormat);
+
+    for (int j = 0; j < nColumns; j++)
+    {
+        double relative = static_cast<double>(values[j]) * inverse;
+        int code = relative > 0 ? static_cast<int>(lround(top + log2(relative) * stepsPerOctave)) : 0;
+
+        code = qBound(0, code, top);
+
+        if (storageFormat == Log8)
+        {
+            rowData[j] = static_cast<quint8>(code);
+        }
+        else
+        {
+            reinterpret_cast<quint16*>(rowData)[j] = static_cast<quint16>(code);
+        }
+    }
+}
+
+const Real *CompactMatrix::row(int i, Real *buffer) const
+{
+    if (storageFormat == Full)
+    {
+        return full.row(i);
+    }
+
+    const quint8 *rowData = rowCodes(i);
+    float scale = scales.get()[i];
+
+    if (storageFormat == Float16)
+    {
+        const qfloat16 *halves = reinterpret_cast<const qfloat16*>(rowData);
+
+        if (std::is_same<Real, float>::value)
+        {
+            float *values = reinterpret_cast<float*>(buffer);
+
+            qFloatFromFloat16(values, halves, nColumns);
+
+            for (int j = 0; j < nColumns; j++)
+            {
+                values[j] *= scale;
+            }
+        }
+        else
+        {
+            float values[chunk];
+
+            for (int j = 0; j < nColumns; j += chunk)
+            {
+                int n = std::min(chunk, nColumns - j);
+
+                qFloatFromFloat16(values, halves + j, n);
+
+                for (int k = 0; k < n; k++)
+                {
+                    buffer[j + k] = static_cast<Real>(values[k] * scale);
+                }
+            }
+        }
+
+        return buffer;
+    }
+
+    // Table lookups, which compilers turn into gathers
+
+    const float *table = logTable(storageFormat);
+
+    if (storageFormat == Log8)
+    {
+        for (int j = 0; j < nColumns; j++)
+        {
+            buffer[j] = static_cast<Real>(table[rowData[j]] * scale);
+        }
+    }
+    else
+    {
+        const quint16 *codes16 = reinterpret_cast<const quint16*>(rowData);
+
+        for (int j = 0; j < nColumns; j++)
+        {
+            buffer[j] = static_cast<Real>(table[codes16[j]] * scale);
+        }
+    }
+
+    return buffer;
+}
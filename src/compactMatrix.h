@@ -0,0 +1,73 @@
+#ifndef COMPACTMATRIX_H
+#define COMPACTMATRIX_H
+
+#include "precision.h"
+#include "matrix.h"
+#include <memory>
+#include <vector>
+
+// Row-major matrix of non-negative values, such as spectra, optionally stored in fewer bits per element.
+// Full keeps a Matrix<Real>. Float16 keeps half precision floats, Log16 and Log8 the logarithm of each value
+// uniformly quantized over a fixed range below its row's maximum. Compact rows are stored relative to that maximum,
+// their scale, so that no row under- or overflows.
+// Worst case relative error per element, values below the floor reading as zero:
+//   Float16  0.05% down to 2^-14 of the row maximum, less precise below, floor 2^-24
+//   Log16    0.02%, floor 2^-32
+//   Log8     2.2%, floor 2^-16 (-96 dB)
+// Principal components and centroids move by about as much: negligibly for Float16 and Log16, by a percent or two
+// for Log8, with which segments close to a cluster boundary may change cluster.
+// Readers decode one row at a time into a buffer of their own, which stays in cache for the kernel that uses it.
+// Copies share their storage. Rows are encoded in place, without detaching: a new matrix may be filled by several
+// workers, a row each, before it is copied.
+
+class CompactMatrix
+{
+public:
+    enum Format
+    {
+        Full,
+        Float16,
+        Log16,
+        Log8
+    };
+
+    CompactMatrix();
+    CompactMatrix(Format format, int rows, int columns);
+
+    // Full precision data is wrapped, sharing its storage
+    CompactMatrix(const Matrix<Real> &matrix);
+
+    Format format() const { return storageFormat; }
+    int rows() const { return nRows; }
+    int columns() const { return nColumns; }
+    bool isEmpty() const { return nRows == 0; }
+    qint64 bytes() const;
+
+    // Row i, straight from storage when full, otherwise decoded into buffer, which holds at least columns() values
+    const Real *row(int i, Real *buffer) const;
+
+    // Full matrices only: rows to write into, collected before any worker starts
+    Real *mutableRow(int i) { return full.mutableRow(i); }
+
+    void encodeRow(int i, const Real *values);
+    void clear();
+
+private:
+    Format storageFormat;
+    int nRows;
+    int nColumns;
+    int rowBytes;
+
+    Matrix<Real> full;
+    std::shared_ptr<quint8> codes;
+    std::shared_ptr<float> scales;
+
+    const quint8 *rowCodes(int i) const { return codes.get() + static_cast<qint64>(i) * rowBytes; }
+    static int elementBytes(Format format);
+    static int maxCode(Format format);
+    static double octaves(Format format);
+    static std::vector<float> buildLogTable(Format format);
+    static const float *logTable(Format format);
+};
+
+#endif
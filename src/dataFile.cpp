@@ -0,0 +1,308 @@
+#include "dataFile.h"
+#include "parallel.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QThread>
+#include <QtEndian>
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <vector>
+
+const char DataFile::magic[4] = { 'P', 'X', 'D', 'F' };
+
+// Header layout (offsets in bytes):
+//  0 magic, 4 version, 8 sample rate, 12 sample type, 16 sample number, 24 min sample, 32 max sample, 40 channels, 44-63 reserved
+// Channels are stored one after another, each sample number long. Zero channels, as written before the field existed, means one.
+
+bool DataFile::isBinary(const QString &filePath)
+{
+    QFile file(filePath);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    char fileMagic[4];
+
+    return file.read(fileMagic, 4) == 4 && memcmp(fileMagic, magic, 4) == 0;
+}
+
+// Text data files hold the sample rate on the first line and one sample per line after it.
+// The body is split at line boundaries into one piece per thread. A first parallel pass counts lines, so that
+// the second pass can parse each piece straight into its final position. Min and max are reduced per piece
+// and merged afterwards. As with QString::toDouble, a line that does not parse yields 0.
+// Both passes poll interrupted between blocks, and an interrupted parse fails.
+
+bool DataFile::parseText(const char *data, qint64 size, int &sampleRate, QVector<Real> &samples, double &minSample, double &maxSample, const std::function<bool()> &interrupted)
+{
+    const char *end = data + size;
+
+    // Sample rate
+
+    const char *firstLineEnd = std::find(data, end, '\n');
+
+    const char *p = data;
+    while (p < firstLineEnd && (*p == ' ' || *p == '\t'))
+    {
+        p++;
+    }
+
+    sampleRate = 0;
+    std::from_chars(p, firstLineEnd, sampleRate);
+
+    if (sampleRate <= 0 || firstLineEnd == end)
+    {
+        return false;
+    }
+
+    const char *body = firstLineEnd + 1;
+
+    // Split body into pieces ending at newlines
+
+    qint64 bodySize = end - body;
+
+    int nThreads = static_cast<int>(qBound<qint64>(1, bodySize / minBytesPerThread, QThread::idealThreadCount()));
+
+    std::vector<const char*> bounds(static_cast<size_t>(nThreads + 1));
+
+    bounds[0] = body;
+
+    for (int t = 1; t < nThreads; t++)
+    {
+        const char *target = std::max(bounds[t - 1], body + bodySize * t / nThreads);
+        const char *newline = std::find(target, end, '\n');
+        bounds[t] = newline == end ? end : newline + 1;
+    }
+
+    bounds[nThreads] = end;
+
+    // Pass 1: count lines, a last line without newline counts if not empty
+
+    std::vector<qint64> offsets(static_cast<size_t>(nThreads + 1), 0);
+
+    Parallel::forEach(nThreads, interrupted, nullptr, [&bounds, &offsets, &interrupted, end](int t)
+    {
+        const char *begin = bounds[t];
+        const char *finish = bounds[t + 1];
+
+        qint64 lines = 0;
+
+        for (const char *block = begin; block < finish && !interrupted(); )
+        {
+            const char *blockEnd = finish - block > minBytesPerThread ? block + minBytesPerThread : finish;
+
+            lines += std::count(block, blockEnd, '\n');
+            block = blockEnd;
+        }
+
+        if (finish == end && begin < finish && finish[-1] != '\n')
+        {
+            lines++;
+        }
+
+        offsets[t + 1] = lines;
+    });
+
+    if (interrupted())
+    {
+        return false;
+    }
+
+    for (int t = 0; t < nThreads; t++)
+    {
+        offsets[t + 1] += offsets[t];
+    }
+
+    if (offsets[nThreads] == 0 || offsets[nThreads] > INT_MAX)
+    {
+        return false;
+    }
+
+    samples.resize(static_cast<int>(offsets[nThreads]));
+
+    // Pass 2: parse each piece into place
+
+    std::vector<double> mins(static_cast<size_t>(nThreads), 0);
+    std::vector<double> maxs(static_cast<size_t>(nThreads), 0);
+
+    Real *output = samples.data();
+
+    Parallel::forEach(nThreads, interrupted, nullptr, [&bounds, &offsets, &mins, &maxs, &interrupted, output](int t)
+    {
+        const char *line = bounds[t];
+        const char *finish = bounds[t + 1];
+
+        Real *out = output + offsets[t];
+        Real *outEnd = output + offsets[t + 1];
+
+        Real min = 0;
+        Real max = 0;
+
+        if (out < outEnd)
+        {
+            min = parseLine(line, finish);
+            max = min;
+        }
+
+        while (out < outEnd)
+        {
+            if ((out - output - offsets[t]) % linesPerCheck == 0 && interrupted())
+            {
+                break;
+            }
+
+            const char *lineEnd = std::find(line, finish, '\n');
+
+            Real datum = parseLine(line, lineEnd);
+            *out++ = datum;
+
+            if (datum < min)
+            {
+                min = datum;
+            }
+            if (datum > max)
+            {
+                max = datum;
+            }
+
+            line = lineEnd + 1;
+        }
+
+        mins[t] = static_cast<double>(min);
+        maxs[t] = static_cast<double>(max);
+    });
+
+    if (interrupted())
+    {
+        return false;
+    }
+
+    // Merge min and max of non-empty pieces in order
+
+    bool first = true;
+
+    for (int t = 0; t < nThreads; t++)
+    {
+        if (offsets[t + 1] > offsets[t])
+        {
+            if (first || mins[t] < minSample)
+            {
+                minSample = mins[t];
+            }
+            if (first || maxs[t] > maxSample)
+            {
+                maxSample = maxs[t];
+            }
+            first = false;
+        }
+    }
+
+    return true;
+}
+
+Real DataFile::parseLine(const char *begin, const char *end)
+{
+    while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '+'))
+    {
+        begin++;
+    }
+
+    Real value = 0;
+    std::from_chars(begin, end, value);
+
+    return value;
+}
+
+bool DataFile::readHeader(const uchar *data, qint64 size, Header &header)
+{
+    if (size < headerSize || memcmp(data, magic, 4) != 0 || qFromLittleEndian<quint32>(data + 4) != version)
+    {
+        return false;
+    }
+
+    header.sampleRate = qFromLittleEndian<quint32>(data + 8);
+    header.sampleType = static_cast<SampleType>(qFromLittleEndian<quint32>(data + 12));
+    header.sampleNumber = qFromLittleEndian<quint64>(data + 16);
+    header.minSample = qFromLittleEndian<double>(data + 24);
+    header.maxSample = qFromLittleEndian<double>(data + 32);
+    header.channels = std::max(qFromLittleEndian<quint32>(data + 40), 1u);
+
+    if (header.sampleType != Float32 && header.sampleType != Float64)
+    {
+        return false;
+    }
+
+    if (header.sampleRate == 0 || header.sampleNumber == 0)
+    {
+        return false;
+    }
+
+    return static_cast<quint64>(size - headerSize) / header.channels >= header.sampleNumber * static_cast<quint64>(sampleSize(header.sampleType));
+}
+
+bool DataFile::write(const QString &filePath, int sampleRate, const QVector<const Real*> &channels, quint64 sampleNumber, double minSample, double maxSample)
+{
+    // Written to a temporary file and renamed into place once complete, readers never see a partial file
+
+    QSaveFile file(filePath);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+
+    uchar header[headerSize];
+    memset(header, 0, headerSize);
+
+    memcpy(header, magic, 4);
+    qToLittleEndian<quint32>(version, header + 4);
+    qToLittleEndian<quint32>(static_cast<quint32>(sampleRate), header + 8);
+    qToLittleEndian<quint32>(nativeSampleType(), header + 12);
+    qToLittleEndian<quint64>(sampleNumber, header + 16);
+    qToLittleEndian<double>(minSample, header + 24);
+    qToLittleEndian<double>(maxSample, header + 32);
+    qToLittleEndian<quint32>(static_cast<quint32>(channels.size()), header + 40);
+
+    if (file.write(reinterpret_cast<const char*>(header), headerSize) != headerSize)
+    {
+        return false;
+    }
+
+    // Samples are written in blocks, byte swapped on big-endian hosts
+
+    const quint64 blockSize = 65536;
+
+    QVector<Real> block(static_cast<int>(blockSize));
+
+    for (const Real *samples : channels)
+    {
+        for (quint64 i = 0; i < sampleNumber; i += blockSize)
+        {
+            quint64 count = qMin(blockSize, sampleNumber - i);
+
+            qToLittleEndian<Real>(samples + i, static_cast<qsizetype>(count), block.data());
+
+            qint64 bytes = static_cast<qint64>(count * sizeof(Real));
+
+            if (file.write(reinterpret_cast<const char*>(block.constData()), bytes) != bytes)
+            {
+                return false;
+            }
+        }
+    }
+
+    return file.commit();
+}
+
+int DataFile::sampleSize(SampleType sampleType)
+{
+    return sampleType == Float64 ? 8 : 4;
+}
+
+DataFile::SampleType DataFile::nativeSampleType()
+{
+    return sizeof(Real) == 8 ? Float64 : Float32;
+}
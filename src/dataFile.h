@@ -0,0 +1,50 @@
+#ifndef DATAFILE_H
+#define DATAFILE_H
+
+#include "precision.h"
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+#include <functional>
+
+// Binary sample container: a 64 byte little-endian header followed by the raw little-endian samples.
+// The samples start at a 64 byte boundary of the file, so a memory mapping of the file can be handed to the analysis as is.
+
+class DataFile
+{
+public:
+    enum SampleType : quint32
+    {
+        Float32 = 0,
+        Float64 = 1
+    };
+
+    struct Header
+    {
+        quint32 sampleRate;
+        SampleType sampleType;
+        quint64 sampleNumber;
+        double minSample;
+        double maxSample;
+        quint32 channels;
+    };
+
+    static const qint64 headerSize = 64;
+
+    static bool isBinary(const QString &filePath);
+    static bool parseText(const char *data, qint64 size, int &sampleRate, QVector<Real> &samples, double &minSample, double &maxSample, const std::function<bool()> &interrupted);
+    static bool readHeader(const uchar *data, qint64 size, Header &header);
+    static bool write(const QString &filePath, int sampleRate, const QVector<const Real*> &channels, quint64 sampleNumber, double minSample, double maxSample);
+    static int sampleSize(SampleType sampleType);
+    static SampleType nativeSampleType();
+
+private:
+    static const char magic[4];
+    static const qint64 minBytesPerThread = 1 << 20;
+    static const int linesPerCheck = 1 << 16;
+
+    static Real parseLine(const char *begin, const char *end);
+    static const quint32 version = 1;
+};
+
+#endif
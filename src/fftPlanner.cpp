@@ -0,0 +1,355 @@
+#include "fftPlanner.h"
+#include <QDir>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cmath>
+
+// FFTW's planner is not thread safe: planning, wisdom import and export all go through this mutex
+
+QMutex FFTPlanner::mutex;
+
+FFTPlanner::FFTPlanner(QObject *parent) : QThread(parent)
+{
+    durations = { 50, 100, 200, 250, 500, 1000 };
+
+    sampleRate = 0;
+    sampleNumber = 0;
+    alignment = 0;
+    firstDuration = 1;
+    firstHopDuration = 1;
+    windowed = false;
+    padded = false;
+    pending = false;
+
+    loadWisdom();
+
+    connect(this, &QThread::finished, this, &FFTPlanner::startPending);
+}
+
+FFTPlanner::~FFTPlanner()
+{
+    quit();
+    requestInterruption();
+    wait();
+}
+
+QString FFTPlanner::wisdomPath()
+{
+    QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(path);
+
+#ifdef DOUBLE_PRECISION
+    return path + "/fftw_wisdom";
+#else
+    return path + "/fftwf_wisdom";
+#endif
+}
+
+void FFTPlanner::loadWisdom()
+{
+    QMutexLocker locker(&mutex);
+
+    FFTW(import_wisdom_from_filename)(wisdomPath().toLocal8Bit().constData());
+}
+
+void FFTPlanner::saveWisdom()
+{
+    QMutexLocker locker(&mutex);
+
+    FFTW(export_wisdom_to_filename)(wisdomPath().toLocal8Bit().constData());
+}
+
+int FFTPlanner::segmentNumber(int nTotalSamples, int nSamples, int nHop)
+{
+    // Segments start every nHop samples and end before the last sample
+
+    return nTotalSamples > nSamples ? (nTotalSamples - nSamples - 1) / nHop + 1 : 0;
+}
+
+int FFTPlanner::smoothSize(int n)
+{
+    // Smallest size from n up with no prime factor above 7
+
+    for (int m = std::max(n, 1); ; m++)
+    {
+        int rest = m;
+
+        for (int p : { 2, 3, 5, 7 })
+        {
+            while (rest % p == 0)
+            {
+                rest /= p;
+            }
+        }
+
+        if (rest == 1)
+        {
+            return m;
+        }
+    }
+}
+
+double FFTPlanner::relativeCost(int n)
+{
+    // Predicted cost of a transform of size n relative to n log2(n), about 1 for powers of two
+
+    return n > 1 ? transformCost(n) / (n * log2(static_cast<double>(n))) : 1;
+}
+
+double FFTPlanner::transformCost(int n)
+{
+    // A rough model of FFTW: one mixed radix pass per prime factor p, costing n / p transforms of size p
+
+    double cost = 0;
+    int rest = n;
+
+    for (int p = 2; p * p <= rest; p++)
+    {
+        while (rest % p == 0)
+        {
+            cost += static_cast<double>(n) / p * primeCost(p);
+            rest /= p;
+        }
+    }
+
+    if (rest > 1)
+    {
+        cost += static_cast<double>(n) / rest * primeCost(rest);
+    }
+
+    return cost;
+}
+
+double FFTPlanner::primeCost(int p)
+{
+    // Radix codelets lose efficiency as the prime grows
+    // Larger primes become a convolution: about three transforms of a fast size at least twice as long
+
+    switch (p)
+    {
+    case 2: return 2.0;
+    case 3: return 3.0 * log2(3.0) * 1.15;
+    case 5: return 5.0 * log2(5.0) * 1.3;
+    case 7: return 7.0 * log2(7.0) * 1.45;
+    case 11: return 11.0 * log2(11.0) * 1.9;
+    case 13: return 13.0 * log2(13.0) * 2.0;
+    default:
+        {
+            int m = smoothSize(2 * p - 1);
+            return 3.0 * transformCost(m) + 6.0 * m;
+        }
+    }
+}
+
+FFTW(plan) FFTPlanner::createPlan(int nSamples, int distance, int howMany, Real *in, FFTW(complex) *out, bool &planned)
+{
+    // Wisdom first, patient planning only for sizes not seen before
+
+    int nFrequencies = nSamples / 2 + 1;
+
+    FFTW(plan) plan = FFTW(plan_many_dft_r2c)(1, &nSamples, howMany, in, nullptr, 1, distance, out, nullptr, 1, nFrequencies, FFTW_PATIENT | FFTW_WISDOM_ONLY);
+
+    if (plan == nullptr)
+    {
+        plan = FFTW(plan_many_dft_r2c)(1, &nSamples, howMany, in, nullptr, 1, distance, out, nullptr, 1, nFrequencies, FFTW_PATIENT);
+        planned = true;
+    }
+
+    return plan;
+}
+
+void FFTPlanner::createPlans(int nSamples, int distance, int nSegments, int alignment, Plans &plans)
+{
+    int nFrequencies = nSamples / 2 + 1;
+
+    plans.nBatch = std::min(batchSegments, nSegments);
+    plans.nTail = nSegments % plans.nBatch;
+    plans.distance = distance;
+    plans.alignment = alignment;
+    plans.tail = nullptr;
+
+    bool planned = false;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        // Planning arrays offset to the requested alignment, planning overwrites them
+
+        Real *in = FFTW(alloc_real)(static_cast<unsigned long>(plans.inputSize(nSamples) + alignment));
+        FFTW(complex) *out = FFTW(alloc_complex)(static_cast<unsigned long>(plans.nBatch * nFrequencies));
+
+        plans.batch = createPlan(nSamples, distance, plans.nBatch, in + alignment, out, planned);
+
+        if (plans.nTail > 0)
+        {
+            plans.tail = createPlan(nSamples, distance, plans.nTail, in + alignment, out, planned);
+        }
+
+        FFTW(free)(in);
+        FFTW(free)(out);
+    }
+
+    if (planned)
+    {
+        saveWisdom();
+    }
+}
+
+void FFTPlanner::destroyPlans(Plans &plans)
+{
+    QMutexLocker locker(&mutex);
+
+    FFTW(destroy_plan)(plans.batch);
+
+    if (plans.tail != nullptr)
+    {
+        FFTW(destroy_plan)(plans.tail);
+    }
+
+    plans.batch = nullptr;
+    plans.tail = nullptr;
+}
+
+void FFTPlanner::createCorrelationPlans(int nSize, CorrelationPlans &plans)
+{
+    int nFrequencies = nSize / 2 + 1;
+
+    plans.size = nSize;
+
+    bool planned = false;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        Real *in = FFTW(alloc_real)(static_cast<unsigned long>(nSize));
+        FFTW(complex) *out = FFTW(alloc_complex)(static_cast<unsigned long>(nFrequencies));
+
+        plans.forward = FFTW(plan_dft_r2c_1d)(nSize, in, out, FFTW_PATIENT | FFTW_WISDOM_ONLY);
+
+        if (plans.forward == nullptr)
+        {
+            plans.forward = FFTW(plan_dft_r2c_1d)(nSize, in, out, FFTW_PATIENT);
+            planned = true;
+        }
+
+        plans.inverse = FFTW(plan_dft_c2r_1d)(nSize, out, in, FFTW_PATIENT | FFTW_WISDOM_ONLY);
+
+        if (plans.inverse == nullptr)
+        {
+            plans.inverse = FFTW(plan_dft_c2r_1d)(nSize, out, in, FFTW_PATIENT);
+            planned = true;
+        }
+
+        FFTW(free)(in);
+        FFTW(free)(out);
+    }
+
+    if (planned)
+    {
+        saveWisdom();
+    }
+}
+
+void FFTPlanner::destroyCorrelationPlans(CorrelationPlans &plans)
+{
+    QMutexLocker locker(&mutex);
+
+    FFTW(destroy_plan)(plans.forward);
+    FFTW(destroy_plan)(plans.inverse);
+
+    plans.forward = nullptr;
+    plans.inverse = nullptr;
+}
+
+void FFTPlanner::prePlan(int rate, unsigned long number, int bufferAlignment, int firstDuration, int firstHopDuration, bool windowed, bool padded)
+{
+    // A pass in progress is interrupted and the new one starts once it has finished, without blocking the caller
+
+    request = { rate, number, bufferAlignment, firstDuration, firstHopDuration, windowed, padded };
+
+    if (isRunning())
+    {
+        requestInterruption();
+        pending = true;
+    }
+    else
+    {
+        pending = true;
+        startPending();
+    }
+}
+
+void FFTPlanner::startPending()
+{
+    if (!pending)
+    {
+        return;
+    }
+
+    pending = false;
+
+    wait();
+
+    sampleRate = request.sampleRate;
+    sampleNumber = request.sampleNumber;
+    alignment = request.alignment;
+    firstDuration = request.firstDuration;
+    firstHopDuration = request.firstHopDuration;
+    windowed = request.windowed;
+    padded = request.padded;
+
+    durations.removeAll(request.firstDuration);
+    durations.prepend(request.firstDuration);
+
+    start(QThread::LowPriority);
+}
+
+void FFTPlanner::cancel()
+{
+    pending = false;
+    requestInterruption();
+}
+
+void FFTPlanner::run()
+{
+    // Same segmentation as the analysis: the plans' wisdom then matches its problems exactly
+
+    int nTotalSamples = static_cast<int>(sampleNumber);
+
+    for (int milliseconds : durations)
+    {
+        if (isInterruptionRequested())
+        {
+            return;
+        }
+
+        // Hops in whole milliseconds and samples, rounded as the analysis rounds them for its extra durations
+
+        int hopDuration = milliseconds == firstDuration ? firstHopDuration : std::max(1, qRound(milliseconds * static_cast<double>(firstHopDuration) / firstDuration));
+        int nSamples = sampleRate * milliseconds / 1000;
+        int nHop = std::max(1, sampleRate * hopDuration / 1000);
+        int nSegments = segmentNumber(nTotalSamples, nSamples, nHop);
+
+        if (nSamples < 10 || nSegments == 0)
+        {
+            continue;
+        }
+
+        // Windowed and padded segments are transformed from a contiguous aligned buffer, others straight from the samples
+
+        Plans plans;
+
+        if (windowed || padded)
+        {
+            int nFFT = padded ? smoothSize(nSamples) : nSamples;
+            createPlans(nFFT, nFFT, nSegments, 0, plans);
+        }
+        else
+        {
+            createPlans(nSamples, nHop, nSegments, alignment, plans);
+        }
+
+        destroyPlans(plans);
+    }
+}
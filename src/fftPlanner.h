@@ -0,0 +1,98 @@
+#ifndef FFTPLANNER_H
+#define FFTPLANNER_H
+
+#include "precision.h"
+#include <QThread>
+#include <QMutex>
+#include <QVector>
+
+// Creates the segment FFT plans and keeps FFTW's wisdom in a per-user file, so that patient planning of a size is paid once.
+// As a thread, it plans the segment durations in common use ahead of time for the loaded file.
+
+class FFTPlanner : public QThread
+{
+    Q_OBJECT
+
+public:
+    FFTPlanner(QObject *parent = nullptr);
+    ~FFTPlanner() override;
+
+    // Plans for full batches of segments and for the remaining segments, starting distance samples apart
+    // in buffers with the given alignment
+    struct Plans
+    {
+        FFTW(plan) batch;
+        FFTW(plan) tail;
+        int nBatch;
+        int nTail;
+        int distance;
+        int alignment;
+
+        int inputSize(int nSamples) const { return (nBatch - 1) * distance + nSamples; }
+    };
+
+    // Forward and inverse plans of a single real transform of the given size, for correlations
+    struct CorrelationPlans
+    {
+        FFTW(plan) forward;
+        FFTW(plan) inverse;
+        int size;
+    };
+
+    static const int batchSegments = 16;
+
+    QVector<int> durations;
+
+    static int segmentNumber(int nTotalSamples, int nSamples, int nHop);
+    static int smoothSize(int n);
+    static double relativeCost(int n);
+    static void createPlans(int nSamples, int distance, int nSegments, int alignment, Plans &plans);
+    static void destroyPlans(Plans &plans);
+    static void createCorrelationPlans(int nSize, CorrelationPlans &plans);
+    static void destroyCorrelationPlans(CorrelationPlans &plans);
+
+    void prePlan(int rate, unsigned long number, int bufferAlignment, int firstDuration, int firstHopDuration, bool windowed, bool padded);
+
+    // Stops after the size being planned and drops any pass waiting to start, without blocking the caller
+    void cancel();
+
+protected:
+    void run() override;
+
+private slots:
+    void startPending();
+
+private:
+    struct Request
+    {
+        int sampleRate;
+        unsigned long sampleNumber;
+        int alignment;
+        int firstDuration;
+        int firstHopDuration;
+        bool windowed;
+        bool padded;
+    };
+
+    static QMutex mutex;
+
+    Request request;
+    bool pending;
+
+    int sampleRate;
+    unsigned long sampleNumber;
+    int alignment;
+    int firstDuration;
+    int firstHopDuration;
+    bool windowed;
+    bool padded;
+
+    static QString wisdomPath();
+    static void loadWisdom();
+    static void saveWisdom();
+    static double transformCost(int n);
+    static double primeCost(int p);
+    static FFTW(plan) createPlan(int nSamples, int distance, int howMany, Real *in, FFTW(complex) *out, bool &planned);
+};
+
+#endif
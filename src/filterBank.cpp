@@ -0,0 +1,366 @@
+#include "filterBank.h"
+#include "laneSum.h"
+#include <algorithm>
+#include <cmath>
+
+FilterBank::FilterBank()
+{
+    bankScale = Linear;
+    nSamples = 0;
+    nSegmentSamples = 0;
+    sampleRate = 0;
+    nBands = 0;
+    nBandsPerOctave = 0;
+}
+
+void FilterBank::clear()
+{
+    centers.clear();
+    firsts.clear();
+    offsets.clear();
+    weights.clear();
+    kernelRe.clear();
+    kernelIm.clear();
+}
+
+void FilterBank::design(Scale newScale, int newSamples, int newSegmentSamples, int newSampleRate, int newBands, int newBandsPerOctave)
+{
+    // Kept while the segment size and scale parameters do not change
+
+    if (isDesigned(newScale, newSamples, newSegmentSamples, newSampleRate, newBands, newBandsPerOctave) && !firsts.isEmpty())
+    {
+        return;
+    }
+
+    bankScale = newScale;
+    nSamples = newSamples;
+    nSegmentSamples = newSegmentSamples;
+    sampleRate = newSampleRate;
+    nBands = newBands;
+    nBandsPerOctave = newBandsPerOctave;
+
+    clear();
+
+    offsets.push_back(0);
+
+    double nyquist = sampleRate / 2.0;
+
+    QVector<double> edges;
+
+    switch (bankScale)
+    {
+    case Linear:
+        break;
+    case Mel:
+        for (int i = 0; i < nBands + 2; i++)
+        {
+            edges.push_back(melToHz(hzToMel(nyquist) * i / (nBands + 1)));
+        }
+        designTriangular(edges);
+        break;
+    case Bark:
+        for (int i = 0; i < nBands + 2; i++)
+        {
+            edges.push_back(barkToHz(hzToBark(0) + (hzToBark(nyquist) - hzToBark(0)) * i / (nBands + 1)));
+        }
+        designTriangular(edges);
+        break;
+    case Logarithmic:
+        for (double f = lowestFrequency(); f <= nyquist; f *= pow(2.0, 1.0 / nBandsPerOctave))
+        {
+            edges.push_back(f);
+        }
+        designTriangular(edges);
+        break;
+    case ConstantQ:
+        designConstantQ();
+        break;
+    }
+}
+
+bool FilterBank::isDesigned(Scale newScale, int newSamples, int newSegmentSamples, int newSampleRate, int newBands, int newBandsPerOctave) const
+{
+    return newScale == bankScale && newSamples == nSamples && newSegmentSamples == nSegmentSamples && newSampleRate == sampleRate && newBands == nBands && newBandsPerOctave == nBandsPerOctave;
+}
+
+double FilterBank::lowestFrequency() const
+{
+    // Lowest frequency whose band is as wide as the frequency resolution of a segment
+    // For constant-Q bands, that whose kernel is as long as the segment
+
+    double Q = 1.0 / (pow(2.0, 1.0 / nBandsPerOctave) - 1.0);
+
+    return Q * sampleRate / nSegmentSamples;
+}
+
+void FilterBank::addBand(double center, int first, const QVector<double> &bandWeights)
+{
+    centers.push_back(center);
+    firsts.push_back(first);
+
+    for (double weight : bandWeights)
+    {
+        weights.push_back(static_cast<float>(weight));
+    }
+
+    offsets.push_back(weights.size());
+}
+
+void FilterBank::designTriangular(const QVector<double> &edges)
+{
+    // Triangles rise from one edge to the next, the band center, and fall to the one after
+    // Weights are normalized to sum one: bands are weighted means of magnitudes, as linear bins are plain means
+    // Bands narrower than the frequency resolution take the frequency nearest to their center
+
+    int nFrequencies = nSamples / 2 + 1;
+    double deltaF = static_cast<double>(sampleRate) / nSamples;
+
+    for (int b = 0; b + 2 < edges.size(); b++)
+    {
+        double low = edges[b];
+        double center = edges[b + 1];
+        double high = edges[b + 2];
+
+        int first = std::max(1, static_cast<int>(ceil(low / deltaF)));
+        int last = std::min(nFrequencies - 1, static_cast<int>(floor(high / deltaF)));
+
+        QVector<double> bandWeights;
+        int bandFirst = first;
+        double sum = 0;
+
+        for (int j = first; j <= last; j++)
+        {
+            double f = j * deltaF;
+            double weight = f < center ? (f - low) / (center - low) : (high - f) / (high - center);
+
+            if (weight <= 0)
+            {
+                if (bandWeights.isEmpty())
+                {
+                    bandFirst = j + 1;
+                }
+                continue;
+            }
+
+            bandWeights.push_back(weight);
+            sum += weight;
+        }
+
+        if (bandWeights.isEmpty())
+        {
+            bandFirst = qBound(1, static_cast<int>(round(center / deltaF)), nFrequencies - 1);
+            bandWeights.push_back(1);
+            sum = 1;
+        }
+
+        for (double &weight : bandWeights)
+        {
+            weight /= sum;
+        }
+
+        addBand(center, bandFirst, bandWeights);
+    }
+}
+
+void FilterBank::designConstantQ()
+{
+    // Band k is centered at the lowest frequency times 2^(k / bands per octave), and measured over
+    // Q periods with a Hann window centered in the segment, Q = 1 / (2^(1 / bands per octave) - 1)
+    // Segments are transformed unwindowed, the kernels' windows being their only one, and centered before any padding
+    // Its spectral kernel, the DFT of the windowed complex exponential, is concentrated about the center:
+    // it is evaluated over the window's main lobe and first side lobes and trimmed to above 0.0054 of its peak
+    // Windows are normalized so that a sinusoid at a band center measures as its peak in the linear spectrum
+
+    int nFrequencies = nSamples / 2 + 1;
+    double Q = 1.0 / (pow(2.0, 1.0 / nBandsPerOctave) - 1.0);
+    double fMax = sampleRate / 2.0 / pow(2.0, 1.0 / nBandsPerOctave);
+
+    QVector<double> window;
+    QVector<double> re;
+    QVector<double> im;
+
+    for (int k = 0; ; k++)
+    {
+        double f = lowestFrequency() * pow(2.0, static_cast<double>(k) / nBandsPerOctave);
+
+        if (f > fMax)
+        {
+            break;
+        }
+
+        int nK = std::min(nSegmentSamples, static_cast<int>(ceil(Q * sampleRate / f)));
+        int offset = (nSegmentSamples - nK) / 2;
+
+        window.resize(nK);
+
+        double windowSum = 0;
+
+        for (int n = 0; n < nK; n++)
+        {
+            window[n] = 0.5 - 0.5 * cos(2.0 * M_PI * n / nK);
+            windowSum += window[n];
+        }
+
+        double center = f * nSamples / sampleRate;
+        double halfWidth = 4.0 * nSamples / nK;
+
+        int first = std::max(1, static_cast<int>(floor(center - halfWidth)));
+        int last = std::min(nFrequencies - 1, static_cast<int>(ceil(center + halfWidth)));
+
+        re.fill(0, last - first + 1);
+        im.fill(0, last - first + 1);
+
+        double peak = 0;
+
+        for (int j = first; j <= last; j++)
+        {
+            // Sum of window(n) e^(2 pi i (f / rate - j / nSamples) n), by rotation, shifted to the window's offset
+
+            double theta = 2.0 * M_PI * (f / sampleRate - static_cast<double>(j) / nSamples);
+            double rotationRe = cos(theta);
+            double rotationIm = sin(theta);
+
+            double zRe = 1;
+            double zIm = 0;
+            double sumRe = 0;
+            double sumIm = 0;
+
+            for (int n = 0; n < nK; n++)
+            {
+                sumRe += window[n] * zRe;
+                sumIm += window[n] * zIm;
+
+                double nextRe = zRe * rotationRe - zIm * rotationIm;
+                zIm = zRe * rotationIm + zIm * rotationRe;
+                zRe = nextRe;
+            }
+
+            double shift = -2.0 * M_PI * j * offset / nSamples;
+
+            re[j - first] = (sumRe * cos(shift) - sumIm * sin(shift)) / windowSum;
+            im[j - first] = (sumRe * sin(shift) + sumIm * cos(shift)) / windowSum;
+
+            peak = std::max(peak, hypot(re[j - first], im[j - first]));
+        }
+
+        int begin = 0;
+        int end = last - first + 1;
+
+        while (begin < end - 1 && hypot(re[begin], im[begin]) < 0.0054 * peak)
+        {
+            begin++;
+        }
+        while (end - 1 > begin && hypot(re[end - 1], im[end - 1]) < 0.0054 * peak)
+        {
+            end--;
+        }
+
+        centers.push_back(f);
+        firsts.push_back(first + begin);
+
+        for (int i = begin; i < end; i++)
+        {
+            kernelRe.push_back(static_cast<Real>(re[i]));
+            kernelIm.push_back(static_cast<Real>(im[i]));
+        }
+
+        offsets.push_back(kernelRe.size());
+    }
+}
+
+double FilterBank::apply(const float *magnitudes, Real *bands) const
+{
+    double maxPower = 0;
+
+    for (int b = 0; b < firsts.size(); b++)
+    {
+        double power = laneDot(weights.constData() + offsets[b], magnitudes + firsts[b], offsets[b + 1] - offsets[b]);
+
+        bands[b] = static_cast<Real>(power);
+
+        if (power > maxPower)
+        {
+            maxPower = power;
+        }
+    }
+
+    return maxPower;
+}
+
+double FilterBank::apply(const FFTW(complex) *spectrum, Real *bands) const
+{
+    // Band value: modulus of the sum of the spectrum times the conjugate kernel
+
+    double maxPower = 0;
+
+    for (int b = 0; b < firsts.size(); b++)
+    {
+        const Real *kRe = kernelRe.constData() + offsets[b];
+        const Real *kIm = kernelIm.constData() + offsets[b];
+        const Real *x = &spectrum[firsts[b]][0];
+
+        int n = offsets[b + 1] - offsets[b];
+
+        Real sumsRe[sumLanes] = {};
+        Real sumsIm[sumLanes] = {};
+
+        int k = 0;
+
+        for (; k + sumLanes <= n; k += sumLanes)
+        {
+            for (int l = 0; l < sumLanes; l++)
+            {
+                sumsRe[l] += x[2 * (k + l)] * kRe[k + l] + x[2 * (k + l) + 1] * kIm[k + l];
+                sumsIm[l] += x[2 * (k + l) + 1] * kRe[k + l] - x[2 * (k + l)] * kIm[k + l];
+            }
+        }
+
+        double sumRe = 0;
+        double sumIm = 0;
+
+        for (; k < n; k++)
+        {
+            sumRe += x[2 * k] * kRe[k] + x[2 * k + 1] * kIm[k];
+            sumIm += x[2 * k + 1] * kRe[k] - x[2 * k] * kIm[k];
+        }
+
+        for (int l = 0; l < sumLanes; l++)
+        {
+            sumRe += sumsRe[l];
+            sumIm += sumsIm[l];
+        }
+
+        double power = sqrt(sumRe * sumRe + sumIm * sumIm);
+
+        bands[b] = static_cast<Real>(power);
+
+        if (power > maxPower)
+        {
+            maxPower = power;
+        }
+    }
+
+    return maxPower;
+}
+
+double FilterBank::hzToMel(double f)
+{
+    return 2595.0 * log10(1.0 + f / 700.0);
+}
+
+double FilterBank::melToHz(double m)
+{
+    return 700.0 * (pow(10.0, m / 2595.0) - 1.0);
+}
+
+double FilterBank::hzToBark(double f)
+{
+    // Traunmueller's approximation
+
+    return 26.81 * f / (1960.0 + f) - 0.53;
+}
+
+double FilterBank::barkToHz(double z)
+{
+    return 1960.0 * (z + 0.53) / (26.28 - z);
+}
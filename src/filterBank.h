@@ -0,0 +1,68 @@
+#ifndef FILTERBANK_H
+#define FILTERBANK_H
+
+#include "precision.h"
+#include <QVector>
+
+// Maps the spectrum of a segment onto fewer, perceptually spaced bands.
+// Mel, Bark and logarithmic banks are triangular filters averaging magnitudes. Constant-Q bands are the
+// spectral kernels of Brown and Puckette, applied to the complex spectrum.
+// Each band is nonzero only over a run of consecutive frequencies, so the bank is stored as sparse rows of
+// first frequency and weights, designed once per segment size and applied with dense dot products.
+// Segments may be zero padded: the transform size sets the frequency grid, the segment length the resolution.
+
+class FilterBank
+{
+public:
+    enum Scale
+    {
+        Linear,
+        Mel,
+        Bark,
+        Logarithmic,
+        ConstantQ
+    };
+
+    FilterBank();
+
+    void design(Scale newScale, int newSamples, int newSegmentSamples, int newSampleRate, int newBands, int newBandsPerOctave);
+    bool isDesigned(Scale newScale, int newSamples, int newSegmentSamples, int newSampleRate, int newBands, int newBandsPerOctave) const;
+    void clear();
+
+    Scale scale() const { return bankScale; }
+    bool isComplex() const { return bankScale == ConstantQ; }
+    int bandNumber() const { return firsts.size(); }
+    const QVector<double> &centerFrequencies() const { return centers; }
+
+    double apply(const float *magnitudes, Real *bands) const;
+    double apply(const FFTW(complex) *spectrum, Real *bands) const;
+
+private:
+    Scale bankScale;
+    int nSamples;
+    int nSegmentSamples;
+    int sampleRate;
+    int nBands;
+    int nBandsPerOctave;
+
+    QVector<double> centers;
+
+    // Band b weighs frequencies firsts[b] onwards with weights from offsets[b] to offsets[b + 1]
+    QVector<int> firsts;
+    QVector<int> offsets;
+    QVector<float> weights;
+    QVector<Real> kernelRe;
+    QVector<Real> kernelIm;
+
+    void designTriangular(const QVector<double> &edges);
+    void designConstantQ();
+    double lowestFrequency() const;
+    void addBand(double center, int first, const QVector<double> &bandWeights);
+
+    static double hzToMel(double f);
+    static double melToHz(double m);
+    static double hzToBark(double f);
+    static double barkToHz(double z);
+};
+
+#endif
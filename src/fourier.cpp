@@ -1,4 +1,6 @@
 #include "fourier.h"
+#include "dataFile.h"
+#include "audioCache.h"
 #define DR_FLAC_IMPLEMENTATION
 #include "dr_flac.h"
 #define DR_MP3_IMPLEMENTATION
@@ -7,17 +9,58 @@
 #include "dr_wav.h"
 #define MINIAUDIO_IMPLEMENTATION
 #include "miniaudio.h"
-#include "fftw3.h"
-#include <QFile>
-#include <QTextStream>
+#include <QtEndian>
+#include <algorithm>
+#include <climits>
+#include <iterator>
+#include <cmath>
+#include <vector>
 
 Fourier::Fourier(QObject *parent) : QThread(parent)
 {
     sampleRate = 0;
     sampleNumber = 0;
     milliseconds = 250;
+    hopMilliseconds = 250;
+    window = Rectangular;
+    kaiserBeta = 8.6;
     frequencyBinSize = 1;
+    scale = FilterBank::Linear;
+    filterBands = 40;
+    bandsPerOctave = 12;
+    padToSmoothSize = false;
+    storageFormat = CompactMatrix::Full;
     duration = 0;
+    channels = 0;
+    keepChannels = false;
+    analysisSampleRate = 0;
+    regionStart = 0;
+    regionEnd = 0;
+    useCache = true;
+    cacheMaxBytes = Q_INT64_C(4) << 30;
+    minTime = 0;
+    maxTime = 0;
+    spectraChannel = -1;
+    supPower = 0;
+    analysis.milliseconds = 0;
+    analysis.hopMilliseconds = 0;
+    analysis.nSamples = 0;
+    analysis.nHop = 1;
+    analysis.nSegments = 0;
+    analysis.binSize = 1;
+    analysis.fftSize = 0;
+    analysis.nFrequencies = 0;
+    analysis.supPower = 0;
+    mappedFile = nullptr;
+
+    task = FFTAnalysis;
+    loadId = 0;
+
+    loaded.mappedFile = nullptr;
+    loaded.sampleNumber = 0;
+    loaded.startTime = 0;
+
+    connect(this, &Fourier::loadFinished, this, &Fourier::publishLoadedFile);
 }
 
 Fourier::~Fourier()
@@ -25,270 +68,1262 @@ Fourier::~Fourier()
     quit();
     requestInterruption();
     wait();
+
+    clearLoadedFile();
+    releaseMappedFile();
 }
 
 void Fourier::readAudioFile(const QString filePath)
 {
-    ma_decoder_config audioConfig = ma_decoder_config_init(ma_format_f32, 1, 0);
+    startTask(ReadAudioFile, filePath);
+}
+
+void Fourier::readDataFile(const QString filePath)
+{
+    startTask(ReadDataFile, filePath);
+}
+
+void Fourier::performFFTAnalysis()
+{
+    startTask(FFTAnalysis, QString());
+}
+
+void Fourier::cancel()
+{
+    requestInterruption();
+    wait();
+}
+
+void Fourier::startTask(Task newTask, const QString filePath)
+{
+    // Interrupt whatever is running, any new task supersedes an in-flight load
+    // Including a load whose result is not published yet: an analysis reads the samples it would swap
+
+    cancel();
+
+    task = newTask;
+    taskFilePath = filePath;
+
+    loadId++;
+
+    start();
+}
+
+void Fourier::run()
+{
+    // Data files are mapped or parsed without a known amount of work: progress shows as busy
+
+    if (task == ReadDataFile)
+    {
+        progress.start(0, "");
+    }
+
+    switch (task)
+    {
+    case ReadAudioFile:
+        decodeAudioFile(taskFilePath, loadId);
+        break;
+    case ReadDataFile:
+        if (DataFile::isBinary(taskFilePath))
+        {
+            if (!mapBinaryDataFile(taskFilePath, loadId) && !isInterruptionRequested())
+            {
+                emit(fileDecodingFailed());
+            }
+        }
+        else
+        {
+            parseTextDataFile(taskFilePath, loadId);
+        }
+        break;
+    case FFTAnalysis:
+        computeFFTs();
+        break;
+    }
+
+    progress.finish();
+}
+
+void Fourier::clearLoadedFile()
+{
+    loaded.waveForms.clear();
+    loaded.waveForms.squeeze();
+
+    delete loaded.mappedFile;
+    loaded.mappedFile = nullptr;
+
+    loaded.samples.clear();
+    loaded.sampleNumber = 0;
+    loaded.startTime = 0;
+}
+
+void Fourier::regionFrames(int rate, quint64 totalFrames, quint64 &firstFrame, quint64 &frameCount) const
+{
+    // Frame range of the region of interest, an end at or before the start means up to the end of the file
+
+    firstFrame = std::min(static_cast<quint64>(std::max(regionStart, 0.0) * rate), totalFrames);
+    frameCount = totalFrames - firstFrame;
+
+    if (regionEnd > regionStart)
+    {
+        frameCount = std::min(frameCount, static_cast<quint64>((regionEnd - regionStart) * rate));
+    }
+}
+
+void Fourier::decodeAudioFile(const QString filePath, int id)
+{
+    clearLoadedFile();
+
+    // A cached decoding with the same options is mapped instead, the region of interest applies to it as to any data file
+
+    QString cachePath;
 
-    ma_uint64 frameCount;
-    void *pAudioData;
+    if (useCache)
+    {
+        cachePath = AudioCache::entryPath(filePath, keepChannels, analysisSampleRate);
+
+        if (isInterruptionRequested())
+        {
+            return;
+        }
 
-    int result = ma_decode_file(filePath.toStdString().c_str(), &audioConfig, &frameCount, &pAudioData);
+        if (!cachePath.isEmpty() && QFile::exists(cachePath))
+        {
+            AudioCache::touch(cachePath);
 
-    if (result != MA_SUCCESS) {
-        ma_free(pAudioData);
+            if (mapBinaryDataFile(cachePath, id) || isInterruptionRequested())
+            {
+                return;
+            }
+        }
+    }
+
+    // Zero channels keeps the file's own channel count, otherwise downmix to mono
+    // A nonzero analysis sample rate resamples while decoding, zero keeps the file's own rate
+
+    ma_decoder_config audioConfig = ma_decoder_config_init(ma_format_f32, keepChannels ? 0 : 1, static_cast<ma_uint32>(analysisSampleRate));
+
+    ma_decoder decoder;
+
+    if (ma_decoder_init_file(filePath.toStdString().c_str(), &audioConfig, &decoder) != MA_SUCCESS)
+    {
         emit(fileDecodingFailed());
         return;
     }
 
-    sampleRate = static_cast<int>(audioConfig.sampleRate);
-    sampleNumber = frameCount;
-    duration = static_cast<int>(1000 * (sampleNumber / static_cast<unsigned long>(sampleRate)));
+    loaded.sampleRate = static_cast<int>(decoder.outputSampleRate);
+
+    int nChannels = static_cast<int>(decoder.outputChannels);
 
-    waveForm.clear();
-    waveForm.reserve(static_cast<int>(frameCount));
+    // Known up front for WAV and FLAC, MP3 needs a scan, zero if unknown
+    // Counted at the file's own rate, scaled to the output rate when resampling
 
-    times.clear();
-    times.reserve(static_cast<int>(frameCount));
+    ma_uint64 expectedFrameCount = ma_decoder_get_length_in_pcm_frames(&decoder);
 
-    float *array = static_cast<float*>(pAudioData);
+    if (decoder.internalSampleRate != decoder.outputSampleRate && decoder.internalSampleRate > 0)
+    {
+        expectedFrameCount = expectedFrameCount * decoder.outputSampleRate / decoder.internalSampleRate;
+    }
 
-    float min = array[0];
-    float max = array[0];
+    // Region of interest: seek to its first frame, given at the file's own rate, and stop after its last one
 
-    for (unsigned int i = 0; i < frameCount; i++)
+    ma_uint64 maxFrameCount = ULLONG_MAX;
+
+    if (regionStart > 0 || regionEnd > regionStart)
     {
-        waveForm.push_back(static_cast<double>(array[i]));
-        times.push_back(static_cast<double>(i) / sampleRate);
-        if (array[i] < min)
+        quint64 firstFrame = 0;
+        quint64 regionFrameCount = 0;
+
+        regionFrames(static_cast<int>(decoder.outputSampleRate), ULLONG_MAX, firstFrame, regionFrameCount);
+
+        if (regionEnd > regionStart)
+        {
+            maxFrameCount = regionFrameCount;
+        }
+
+        if (firstFrame > 0)
         {
-            min = array[i];
+            ma_uint64 internalFrame = static_cast<ma_uint64>(regionStart * decoder.internalSampleRate);
+
+            if (expectedFrameCount > 0 && firstFrame >= expectedFrameCount)
+            {
+                ma_decoder_uninit(&decoder);
+                emit(fileDecodingFailed());
+                return;
+            }
+
+            if (ma_decoder_seek_to_pcm_frame(&decoder, internalFrame) != MA_SUCCESS)
+            {
+                ma_decoder_uninit(&decoder);
+                emit(fileDecodingFailed());
+                return;
+            }
+
+            loaded.startTime = static_cast<double>(internalFrame) / decoder.internalSampleRate;
         }
-        if (array[i] > max)
+
+        if (expectedFrameCount > 0)
         {
-            max = array[i];
+            expectedFrameCount = std::min(expectedFrameCount - std::min(firstFrame, expectedFrameCount), maxFrameCount);
         }
     }
 
-    minWaveForm = static_cast<double>(min);
-    maxWaveForm = static_cast<double>(max);
+    loaded.waveForms.resize(nChannels);
 
-    minTime = times.first();
-    maxTime = times.last();
+    for (QVector<Real> &channelWaveForm : loaded.waveForms)
+    {
+        channelWaveForm.reserve(static_cast<int>(expectedFrameCount));
+    }
 
-    ma_free(pAudioData);
+    // Decode in fixed-size chunks straight into the analysis buffers
 
-    emit(fileRead());
+    QVector<float> chunk(chunkFrames * nChannels);
+
+    float min = 0;
+    float max = 0;
+
+    ma_uint64 frameCount = 0;
+
+    progress.start(static_cast<qint64>(expectedFrameCount), "frames");
+
+    while (true)
+    {
+        if (isInterruptionRequested())
+        {
+            ma_decoder_uninit(&decoder);
+            clearLoadedFile();
+            return;
+        }
+
+        ma_uint64 framesToRead = std::min(static_cast<ma_uint64>(chunkFrames), maxFrameCount - frameCount);
+
+        ma_uint64 framesRead = ma_decoder_read_pcm_frames(&decoder, chunk.data(), framesToRead);
+
+        if (frameCount == 0 && framesRead > 0)
+        {
+            min = chunk[0];
+            max = chunk[0];
+        }
+
+        // De-interleave: frame i holds one sample per channel
+
+        const float *frame = chunk.constData();
+
+        for (ma_uint64 i = 0; i < framesRead; i++)
+        {
+            for (int c = 0; c < nChannels; c++)
+            {
+                float sample = frame[c];
+
+                loaded.waveForms[c].push_back(static_cast<Real>(sample));
+
+                if (sample < min)
+                {
+                    min = sample;
+                }
+                if (sample > max)
+                {
+                    max = sample;
+                }
+            }
+
+            frame += nChannels;
+        }
+
+        frameCount += framesRead;
+
+        progress.setDone(static_cast<qint64>(std::min(frameCount, expectedFrameCount)));
+
+        if (framesRead < static_cast<ma_uint64>(chunkFrames) || frameCount == maxFrameCount)
+        {
+            break;
+        }
+    }
+
+    ma_decoder_uninit(&decoder);
+
+    if (frameCount == 0)
+    {
+        emit(fileDecodingFailed());
+        return;
+    }
+
+    for (const QVector<Real> &channelWaveForm : loaded.waveForms)
+    {
+        loaded.samples.push_back(channelWaveForm.constData());
+    }
+
+    loaded.sampleNumber = frameCount;
+    loaded.minWaveForm = static_cast<double>(min);
+    loaded.maxWaveForm = static_cast<double>(max);
+
+    // Only whole files are cached, before publishing hands the buffers over to the GUI thread
+
+    if (!cachePath.isEmpty() && regionStart <= 0 && regionEnd <= regionStart)
+    {
+        if (DataFile::write(cachePath, loaded.sampleRate, loaded.samples, loaded.sampleNumber, loaded.minWaveForm, loaded.maxWaveForm))
+        {
+            AudioCache::evict(cacheMaxBytes);
+        }
+    }
+
+    emit(loadFinished(id));
 }
 
-void Fourier::readDataFile(const QString filePath)
+void Fourier::parseTextDataFile(const QString filePath, int id)
 {
+    clearLoadedFile();
+
     QFile file(filePath);
 
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0)
+    {
+        emit(fileDecodingFailed());
+        return;
+    }
+
+    const char *data = reinterpret_cast<const char*>(file.map(0, file.size()));
+
+    loaded.waveForms.resize(1);
+
+    // Polled by the parsing threads, so that a new selection does not wait for the whole file
+
+    bool parsed = data != nullptr && DataFile::parseText(data, file.size(), loaded.sampleRate, loaded.waveForms[0], loaded.minWaveForm, loaded.maxWaveForm, [this](){ return isInterruptionRequested(); });
+
+    if (isInterruptionRequested())
     {
+        clearLoadedFile();
         return;
     }
 
-    QTextStream in(&file);
+    if (!parsed)
+    {
+        clearLoadedFile();
+        emit(fileDecodingFailed());
+        return;
+    }
 
-    sampleRate = in.readLine().toInt();
+    // Keep the region of interest only, extremes stay those of the whole file
 
-    waveForm.clear();
-    times.clear();
+    QVector<Real> &waveForm = loaded.waveForms[0];
 
-    unsigned long i = 0;
-    double firstDatum = in.readLine().toDouble();
-    waveForm.push_back(firstDatum);
-    times.push_back(static_cast<double>(i) / sampleRate);
-    i++;
+    quint64 firstFrame = 0;
+    quint64 frameCount = 0;
 
-    minWaveForm = firstDatum;
-    maxWaveForm = firstDatum;
+    regionFrames(loaded.sampleRate, static_cast<quint64>(waveForm.size()), firstFrame, frameCount);
 
-    while (!in.atEnd())
+    if (frameCount == 0)
     {
-        double datum = in.readLine().toDouble();
-        waveForm.push_back(datum);
-        times.push_back(static_cast<double>(i) / sampleRate);
-        i++;
+        clearLoadedFile();
+        emit(fileDecodingFailed());
+        return;
+    }
+
+    waveForm.remove(0, static_cast<int>(firstFrame));
+    waveForm.resize(static_cast<int>(frameCount));
+
+    loaded.samples.push_back(waveForm.constData());
+    loaded.sampleNumber = static_cast<unsigned long>(frameCount);
+    loaded.startTime = static_cast<double>(firstFrame) / loaded.sampleRate;
+
+    emit(loadFinished(id));
+}
+
+bool Fourier::mapBinaryDataFile(const QString filePath, int id)
+{
+    clearLoadedFile();
+
+    QFile *file = new QFile(filePath);
 
-        if (datum < minWaveForm)
+    uchar *data = nullptr;
+    DataFile::Header header;
+
+    if (file->open(QIODevice::ReadOnly))
+    {
+        data = file->map(0, file->size());
+    }
+
+    if (data == nullptr || !DataFile::readHeader(data, file->size(), header) || header.sampleNumber > static_cast<quint64>(INT_MAX))
+    {
+        delete file;
+        return false;
+    }
+
+    // Region of interest: offset into the mapping, extremes stay those of the whole file
+
+    quint64 firstFrame = 0;
+    quint64 frameCount = 0;
+
+    regionFrames(static_cast<int>(header.sampleRate), header.sampleNumber, firstFrame, frameCount);
+
+    if (frameCount == 0)
+    {
+        delete file;
+        return false;
+    }
+
+    int nChannels = static_cast<int>(header.channels);
+    quint64 channelSize = header.sampleNumber * static_cast<quint64>(DataFile::sampleSize(header.sampleType));
+
+    const uchar *payload = data + DataFile::headerSize + firstFrame * static_cast<quint64>(DataFile::sampleSize(header.sampleType));
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    bool native = header.sampleType == DataFile::nativeSampleType();
+#else
+    bool native = false;
+#endif
+
+    if (native)
+    {
+        // Analyze straight from the mapping: no parse step and no copy
+        // The mapping is handed over to the GUI thread, which owns the published samples
+
+        file->moveToThread(thread());
+
+        loaded.mappedFile = file;
+
+        for (int c = 0; c < nChannels; c++)
         {
-            minWaveForm = datum;
+            loaded.samples.push_back(reinterpret_cast<const Real*>(payload + c * channelSize));
         }
-        if (datum > maxWaveForm)
+    }
+    else
+    {
+        // Sample type or byte order differ from ours: convert into the sample buffers
+
+        int n = static_cast<int>(frameCount);
+
+        loaded.waveForms.resize(nChannels);
+
+        for (int c = 0; c < nChannels; c++)
         {
-            maxWaveForm = datum;
+            const uchar *channelPayload = payload + c * channelSize;
+
+            QVector<Real> &waveForm = loaded.waveForms[c];
+            waveForm.resize(n);
+
+            for (int i = 0; i < n; i++)
+            {
+                if (i % chunkFrames == 0 && isInterruptionRequested())
+                {
+                    clearLoadedFile();
+                    delete file;
+                    return false;
+                }
+
+                if (header.sampleType == DataFile::Float64)
+                {
+                    waveForm[i] = static_cast<Real>(qFromLittleEndian<double>(channelPayload + 8 * static_cast<qint64>(i)));
+                }
+                else
+                {
+                    waveForm[i] = static_cast<Real>(qFromLittleEndian<float>(channelPayload + 4 * static_cast<qint64>(i)));
+                }
+            }
+
+            loaded.samples.push_back(waveForm.constData());
         }
+
+        delete file;
     }
 
-    minTime = times.first();
-    maxTime = times.last();
+    loaded.sampleRate = static_cast<int>(header.sampleRate);
+    loaded.sampleNumber = frameCount;
+    loaded.startTime = static_cast<double>(firstFrame) / header.sampleRate;
+    loaded.minWaveForm = header.minSample;
+    loaded.maxWaveForm = header.maxSample;
 
-    sampleNumber = i;
+    emit(loadFinished(id));
+
+    return true;
+}
+
+void Fourier::publishLoadedFile(int id)
+{
+    // Runs on the GUI thread once the worker is done, loads superseded in the meantime are dropped
+
+    if (id != loadId)
+    {
+        return;
+    }
+
+    releaseMappedFile();
+
+    waveForms.swap(loaded.waveForms);
+    loaded.waveForms.clear();
+    loaded.waveForms.squeeze();
+
+    mappedFile = loaded.mappedFile;
+    loaded.mappedFile = nullptr;
+
+    samples.swap(loaded.samples);
+    loaded.samples.clear();
+
+    channels = samples.size();
+    spectraChannel = -1;
+
+    sampleRate = loaded.sampleRate;
+    sampleNumber = loaded.sampleNumber;
     duration = static_cast<int>(1000 * (sampleNumber / static_cast<unsigned long>(sampleRate)));
 
+    minWaveForm = loaded.minWaveForm;
+    maxWaveForm = loaded.maxWaveForm;
+
+    minTime = loaded.startTime;
+    maxTime = minTime + static_cast<double>(sampleNumber - 1) / sampleRate;
+
     emit(fileRead());
 }
 
-void Fourier::performFFTAnalysis()
+bool Fourier::writeBinaryDataFile(const QString filePath)
 {
-    start();
+    if (samples.isEmpty() || sampleNumber == 0)
+    {
+        return false;
+    }
+
+    return DataFile::write(filePath, sampleRate, samples, sampleNumber, minWaveForm, maxWaveForm);
 }
 
-void Fourier::run()
+void Fourier::releaseMappedFile()
 {
-    step = 0;
-    emit(fftAnalysisStep(step));
+    if (mappedFile != nullptr)
+    {
+        samples.clear();
 
-    spectrum.clear();
+        delete mappedFile;
+        mappedFile = nullptr;
+    }
+}
 
-    int nSamples = static_cast<int>(sampleRate) * milliseconds / 1000;
-    nFrequencies = nSamples / 2 + 1;
+struct Fourier::Transform
+{
+    Resolution *resolution;
+    FFTPlanner::Plans plans;
+    CompactMatrix *spectra;
+    std::vector<Real*> rows;
+    std::vector<float*> magnitudeRows;
+    int firstBatch;
+    int nChannelBatches;
+};
+
+void Fourier::computeFFTs()
+{
+    // The displayed segment duration goes first, followed by those precomputed along with it
+    // Extra durations keep the hop's fraction of the segment duration
 
-    double *in = fftw_alloc_real(static_cast<unsigned long>(nSamples));
-    fftw_complex *out = fftw_alloc_complex(static_cast<unsigned long>(nFrequencies));
+    QVector<int> durations = { milliseconds };
 
-    emit(sendMessage("Planning FFT..."));
+    for (int duration : extraDurations)
+    {
+        if (!durations.contains(duration) && sampleRate * duration / 1000 >= 2)
+        {
+            durations.push_back(duration);
+        }
+    }
 
-    fftw_plan plan = fftw_plan_dft_r2c_1d(static_cast<int>(nSamples), in, out, FFTW_PATIENT | FFTW_DESTROY_INPUT);
+    double hopFraction = static_cast<double>(hopMilliseconds) / milliseconds;
 
-    emit(sendMessage("Computing FFTs..."));
+    analysis.channelSpectra.clear();
+    analysis.magnitudes.clear();
+    resolutions.clear();
+
+    std::vector<Resolution> analyses(static_cast<size_t>(durations.size()));
+    std::vector<Transform> transforms(analyses.size());
+
+    qint64 nTotalSegments = 0;
+
+    for (size_t r = 0; r < analyses.size(); r++)
+    {
+        int duration = durations[static_cast<int>(r)];
+
+        setupResolution(analyses[r], duration, r == 0 ? hopMilliseconds : std::max(1, qRound(duration * hopFraction)));
+
+        transforms[r].resolution = &analyses[r];
+
+        nTotalSegments += static_cast<qint64>(analyses[r].nSegments) * channels;
+    }
+
+    progress.start(nTotalSegments, "segments");
 
-    QVector<std::complex<double>> power(nFrequencies, std::complex<double>(0, 0));
+    // Binned magnitudes are written straight into their final rows
+    // The bin size is fixed for the whole analysis, even if changed meanwhile
 
-    for (int i = 0; i < waveForm.size(); i += nSamples)
+    for (Transform &transform : transforms)
     {
-        if (i + nSamples < waveForm.size())
+        Resolution &resolution = *transform.resolution;
+
+        allocateSpectra(resolution, transform.rows);
+
+        transform.spectra = resolution.channelSpectra.data();
+
+        // Full resolution magnitudes are kept, so that a new bin size only redoes the reduction
+
+        if (storageFormat == CompactMatrix::Full)
         {
-            for (int j = 0; j < nSamples; j++)
+            for (int channel = 0; channel < channels; channel++)
             {
-                in[j] = waveForm[i + j];
+                resolution.magnitudes.push_back(Matrix<float>(resolution.nSegments, resolution.nFrequencies));
+
+                for (int segment = 0; segment < resolution.nSegments; segment++)
+                {
+                    transform.magnitudeRows.push_back(resolution.magnitudes.back().mutableRow(segment));
+                }
             }
+        }
+    }
 
-            fftw_execute(plan);
+    // Each resolution has its own plans
+    // Windowed and padded segments are written side by side into an aligned buffer as they are copied
+    // Otherwise plans share the SIMD alignment of the first channel's samples, so that they can run on them directly
 
-            for (int j = 0; j < nFrequencies; j++)
-            {
-                power[j] = std::complex<double>(out[j][0], out[j][1]);
-            }
+    emit(sendMessage("Planning FFT..."));
+
+    int nBatches = 0;
+
+    for (Transform &transform : transforms)
+    {
+        const Resolution &resolution = *transform.resolution;
+
+        transform.firstBatch = nBatches;
+        transform.nChannelBatches = 0;
+
+        if (resolution.nSegments == 0)
+        {
+            continue;
+        }
+
+        if (resolution.windowCoefficients.isEmpty() && resolution.fftSize == resolution.nSamples)
+        {
+            FFTPlanner::createPlans(resolution.nSamples, resolution.nHop, resolution.nSegments, samplesAlignment(), transform.plans);
+        }
+        else
+        {
+            FFTPlanner::createPlans(resolution.fftSize, resolution.fftSize, resolution.nSegments, 0, transform.plans);
+        }
+
+        transform.nChannelBatches = (resolution.nSegments + transform.plans.nBatch - 1) / transform.plans.nBatch;
+
+        nBatches += channels * transform.nChannelBatches;
+    }
+
+    emit(sendMessage("Computing FFTs..."));
+
+    // A pool of workers takes batches of all resolutions and channels in turn, sharing the plans through the new-array execute interface
+
+    int nThreads = Parallel::workerCount(nBatches);
+
+    std::vector<double> maxPowers(static_cast<size_t>(nThreads) * transforms.size(), 0);
+
+    Parallel::run(nBatches, [this](){ return isInterruptionRequested(); }, [this, &transforms, &maxPowers](int t, Parallel::Items &batches)
+    {
+        transformBatches(transforms, batches, maxPowers.data() + static_cast<size_t>(t) * transforms.size());
+    });
+
+    for (Transform &transform : transforms)
+    {
+        if (transform.nChannelBatches > 0)
+        {
+            FFTPlanner::destroyPlans(transform.plans);
+        }
+    }
 
-            spectrum.push_back(power);
+    if (isInterruptionRequested())
+    {
+        analysis.channelSpectra.clear();
+        analysis.channelSpectra.squeeze();
+        analysis.magnitudes.clear();
+        analysis.magnitudes.shrink_to_fit();
+        return;
+    }
 
-            step++;
-            emit(fftAnalysisStep(step));
+    for (size_t r = 0; r < analyses.size(); r++)
+    {
+        for (int t = 0; t < nThreads; t++)
+        {
+            analyses[r].supPower = std::max(analyses[r].supPower, maxPowers[static_cast<size_t>(t) * transforms.size() + r]);
         }
     }
 
-    fftw_destroy_plan(plan);
-    fftw_free(in);
-    fftw_free(out);
+    analysis = std::move(analyses[0]);
+    resolutions.assign(std::make_move_iterator(analyses.begin() + 1), std::make_move_iterator(analyses.end()));
 
     obtainSpectra();
 }
 
-void Fourier::obtainSpectra()
+void Fourier::setupResolution(Resolution &resolution, int duration, int hopDuration)
 {
-    int nFrequencyBins = static_cast<int>(ceil(static_cast<double>(nFrequencies - 1) / frequencyBinSize));
+    resolution.milliseconds = duration;
+    resolution.hopMilliseconds = hopDuration;
+    resolution.nSamples = sampleRate * duration / 1000;
+    resolution.nHop = std::max(1, sampleRate * hopDuration / 1000);
 
-    double deltaF = 1000.0 / milliseconds;
+    // Segments may be zero padded to a fast transform size, which refines the frequency grid
+    // without changing time resolution
 
-    frequencies.clear();
-    frequencies.reserve(nFrequencyBins);
+    resolution.fftSize = fftSize(resolution.nSamples);
+    resolution.nFrequencies = resolution.fftSize / 2 + 1;
 
-    for (int i = 0; i < nFrequencyBins; i++)
+    // Segments start nHop samples apart in the sample buffer: a batch of them is a single strided transform
+
+    resolution.nSegments = FFTPlanner::segmentNumber(static_cast<int>(sampleNumber), resolution.nSamples, resolution.nHop);
+    resolution.binSize = frequencyBinSize;
+    resolution.supPower = 0;
+
+    designFilterBank(resolution);
+
+    // Constant-Q kernels carry their own window: segments are framed rectangular for them
+
+    resolution.windowCoefficients.clear();
+
+    resolution.window = resolution.filterBank.isComplex() ? Rectangular : window;
+    resolution.kaiserBeta = kaiserBeta;
+
+    if (resolution.window != Rectangular)
     {
-        frequencies.push_back(((i + 1.0) * frequencyBinSize - (frequencyBinSize >> 1))* deltaF);
+        resolution.windowCoefficients = windowFunction(resolution.window, resolution.nSamples, kaiserBeta);
     }
+}
 
-    spectra.clear();
-    spectra.reserve(static_cast<int>(spectrum.size()));
+void Fourier::transformBatches(const std::vector<Transform> &transforms, Parallel::Items &batches, double *maxPowers)
+{
+    // Batches are transformed into this worker's output buffer, their magnitudes stored and binned into their own rows
+    // while still in cache, so results do not depend on scheduling and no complex spectra are kept
+    // Unwindowed batches are read straight from the sample buffer, unless its alignment differs from the planned one
+    // Windowed, padded and misaligned batches go through this worker's input buffer, allocated with the planned alignment
+    // Compact spectra are reduced into this worker's rows, then encoded into their own
+    // Buffers are sized for the largest resolution
+
+    int outSize = 0;
+    int bufferSize = 0;
+    int maxFrequencies = 0;
+    int maxBins = 0;
+
+    for (const Transform &transform : transforms)
+    {
+        if (transform.nChannelBatches > 0)
+        {
+            outSize = std::max(outSize, transform.plans.nBatch * transform.resolution->nFrequencies);
+            bufferSize = std::max(bufferSize, transform.plans.inputSize(transform.resolution->fftSize) + transform.plans.alignment);
+            maxFrequencies = std::max(maxFrequencies, transform.resolution->nFrequencies);
+            maxBins = std::max(maxBins, transform.spectra[0].columns());
+        }
+    }
 
-    QVector<double> components;
-    components.reserve(nFrequencyBins);
+    Real *buffer = nullptr;
+    FFTW(complex) *out = FFTW(alloc_complex)(static_cast<unsigned long>(outSize));
+    std::vector<double> prefix(static_cast<size_t>(maxFrequencies));
+    std::vector<float> magnitudeRow(static_cast<size_t>(maxFrequencies));
+    std::vector<Real> componentRow(static_cast<size_t>(maxBins));
 
-    for (QVector<std::complex<double>> oneSpectrum : spectrum)
+    for (int batch = batches.next(); batch >= 0; batch = batches.next())
     {
-        components.clear();
+        size_t r = 0;
+
+        while (r + 1 < transforms.size() && transforms[r + 1].firstBatch <= batch)
+        {
+            r++;
+        }
+
+        const Transform &transform = transforms[r];
+        const FFTPlanner::Plans &plans = transform.plans;
+        Resolution &resolution = *transform.resolution;
+
+        int nSamples = resolution.nSamples;
+        int nHop = resolution.nHop;
+        int nSegments = resolution.nSegments;
+        int nFrequencies = resolution.nFrequencies;
+        int size = resolution.fftSize;
+
+        int channel = (batch - transform.firstBatch) / transform.nChannelBatches;
+        int segment = ((batch - transform.firstBatch) % transform.nChannelBatches) * plans.nBatch;
+        int count = std::min(plans.nBatch, nSegments - segment);
 
-        int j = 1; // Skip first (DC) component (frequency index = 0)
+        FFTW(plan) plan = count == plans.nBatch ? plans.batch : plans.tail;
 
-        bool iterate = true;
+        Real *in = const_cast<Real*>(samples[channel]) + static_cast<qint64>(segment) * nHop;
 
-        while (iterate)
+        bool windowed = !resolution.windowCoefficients.isEmpty();
+        bool padded = size > nSamples;
+
+        if (windowed || padded || FFTW(alignment_of)(in) / static_cast<int>(sizeof(Real)) != plans.alignment)
         {
-            double sum = 0;
+            if (buffer == nullptr)
+            {
+                buffer = FFTW(alloc_real)(static_cast<unsigned long>(bufferSize));
+            }
 
-            for (int k = j; k < j + frequencyBinSize; k++)
+            if (windowed || padded)
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    const Real *segmentIn = in + static_cast<qint64>(i) * nHop;
+                    Real *frame = buffer + i * size;
+
+                    if (windowed)
+                    {
+                        multiplyWindow(segmentIn, resolution.windowCoefficients.constData(), frame, nSamples);
+                    }
+                    else
+                    {
+                        std::copy(segmentIn, segmentIn + nSamples, frame);
+                    }
+
+                    std::fill(frame + nSamples, frame + size, static_cast<Real>(0));
+                }
+            }
+            else
             {
-                sum += std::abs(oneSpectrum[k]);
+                std::copy(in, in + (count - 1) * nHop + nSamples, buffer + plans.alignment);
             }
 
-            sum /= frequencyBinSize;
+            in = buffer + plans.alignment;
+        }
+
+        FFTW(execute_dft_r2c)(plan, in, out);
 
-            components.push_back(sum);
+        for (int i = 0; i < count; i++)
+        {
+            const FFTW(complex) *spectrum = out + i * nFrequencies;
+            float *rowMagnitudes = transform.magnitudeRows.empty() ? magnitudeRow.data() : transform.magnitudeRows[static_cast<size_t>(channel * nSegments + segment + i)];
 
-            if (sum > supPower)
+            for (int k = 0; k < nFrequencies; k++)
             {
-                supPower= sum;
+                rowMagnitudes[k] = static_cast<float>(sqrt(static_cast<double>(spectrum[k][0]) * spectrum[k][0] + static_cast<double>(spectrum[k][1]) * spectrum[k][1]));
             }
 
-            if (j + 2 * frequencyBinSize < nFrequencies)
+            Real *components = transform.rows.empty() ? componentRow.data() : transform.rows[static_cast<size_t>(channel * nSegments + segment + i)];
+
+            double power = resolution.filterBank.isComplex() ? resolution.filterBank.apply(spectrum, components) : reduceMagnitudes(resolution, rowMagnitudes, prefix.data(), components);
+
+            if (transform.rows.empty())
             {
-                j += frequencyBinSize;
+                transform.spectra[channel].encodeRow(segment + i, components);
             }
-            else
+
+            if (power > maxPowers[r])
             {
-                iterate = false;
+                maxPowers[r] = power;
             }
         }
 
-        if (j < nFrequencies - 1)
+        progress.advance(count);
+    }
+
+    FFTW(free)(buffer);
+    FFTW(free)(out);
+}
+
+double Fourier::binMagnitudes(const float *rowMagnitudes, int nFrequencies, int binSize, double *prefix, Real *components)
+{
+    // Mean magnitude of each run of binSize frequencies, skipping the DC component (frequency index = 0)
+    // The last bin holds the frequencies left over, possibly fewer
+    // Bins are differences of the row's prefix sums, so any bin size costs one pass over the frequencies
+
+    prefix[0] = 0;
+
+    for (int k = 1; k < nFrequencies; k++)
+    {
+        prefix[k] = prefix[k - 1] + static_cast<double>(rowMagnitudes[k]);
+    }
+
+    double maxPower = 0;
+
+    for (int j = 1, bin = 0; j < nFrequencies; j += binSize, bin++)
+    {
+        int end = std::min(j + binSize, nFrequencies);
+
+        double mean = (prefix[end - 1] - prefix[j - 1]) / (end - j);
+
+        components[bin] = static_cast<Real>(mean);
+
+        if (mean > maxPower)
         {
-            int delta = nFrequencies - 1 - j;
+            maxPower = mean;
+        }
+    }
+
+    return maxPower;
+}
+
+double Fourier::reduceMagnitudes(const Resolution &resolution, const float *rowMagnitudes, double *prefix, Real *components)
+{
+    if (resolution.filterBank.scale() == FilterBank::Linear)
+    {
+        return binMagnitudes(rowMagnitudes, resolution.nFrequencies, resolution.binSize, prefix, components);
+    }
 
-            double sum = 0;
+    return resolution.filterBank.apply(rowMagnitudes, components);
+}
+
+void Fourier::designFilterBank(Resolution &resolution)
+{
+    // Designed for the segment size of the analysis, kept while it does not change
+    // A scale with no band at this size, for too short segments, falls back to linear bins
+
+    resolution.filterBank.design(scale, resolution.fftSize, resolution.nSamples, sampleRate, filterBands, bandsPerOctave);
+
+    if (resolution.filterBank.bandNumber() == 0)
+    {
+        resolution.filterBank.design(FilterBank::Linear, resolution.fftSize, resolution.nSamples, sampleRate, filterBands, bandsPerOctave);
+    }
+}
 
-            for (int k = j; k < nFrequencies; k++)
+void Fourier::allocateSpectra(Resolution &resolution, std::vector<Real*> &rows)
+{
+    // Full precision rows are written in place, compact ones are encoded row by row and leave rows empty
+
+    int nSegments = resolution.nSegments;
+    int nFrequencyBins = resolution.filterBank.scale() == FilterBank::Linear ? static_cast<int>(ceil(static_cast<double>(resolution.nFrequencies - 1) / resolution.binSize)) : resolution.filterBank.bandNumber();
+
+    resolution.channelSpectra.clear();
+    resolution.channelSpectra.reserve(channels);
+
+    rows.clear();
+    rows.reserve(static_cast<size_t>(channels * nSegments));
+
+    for (int c = 0; c < channels; c++)
+    {
+        CompactMatrix oneChannelSpectra(storageFormat, nSegments, nFrequencyBins);
+
+        if (storageFormat == CompactMatrix::Full)
+        {
+            for (int i = 0; i < nSegments; i++)
             {
-                sum += std::abs(oneSpectrum[k]);
+                rows.push_back(oneChannelSpectra.mutableRow(i));
             }
+        }
+
+        resolution.channelSpectra.push_back(oneChannelSpectra);
+    }
+}
+
+bool Fourier::canRebinSpectra() const
+{
+    // Constant-Q bands need the complex spectra, which are not kept
+    // Magnitudes framed with another window than the selected one, as those of a constant-Q analysis, would not
+    // reduce to the spectra of a new analysis
+
+    if (analysis.magnitudes.empty() || scale == FilterBank::ConstantQ || analysis.filterBank.isComplex())
+    {
+        return false;
+    }
+
+    return analysis.window == window && (window != Kaiser || analysis.kaiserBeta == kaiserBeta);
+}
+
+QVector<int> Fourier::precomputedDurations() const
+{
+    QVector<int> durations;
 
-            sum /= delta;
+    for (const Resolution &resolution : resolutions)
+    {
+        durations.push_back(resolution.milliseconds);
+    }
 
-            components.push_back(sum);
+    return durations;
+}
 
-            if (sum > supPower)
+bool Fourier::selectResolution(int duration)
+{
+    // Swaps the displayed spectra for those of a precomputed segment duration, keeping the ones displayed until now
+    // They are reduced again only if the bin size or scale changed since they were computed, and only from magnitudes framed with the selected window
+
+    auto found = std::find_if(resolutions.begin(), resolutions.end(), [duration](const Resolution &resolution){ return resolution.milliseconds == duration; });
+
+    if (found == resolutions.end())
+    {
+        return false;
+    }
+
+    std::swap(analysis, *found);
+
+    milliseconds = analysis.milliseconds;
+    hopMilliseconds = analysis.hopMilliseconds;
+
+    bool reduced = analysis.filterBank.isDesigned(scale, analysis.fftSize, analysis.nSamples, sampleRate, filterBands, bandsPerOctave) && (scale != FilterBank::Linear || analysis.binSize == frequencyBinSize);
+
+    if (!reduced && canRebinSpectra())
+    {
+        rebinSpectra();
+        return true;
+    }
+
+    supPower = analysis.supPower;
+
+    obtainFrequencies();
+    selectSpectraChannel(spectraChannel);
+
+    return true;
+}
+
+void Fourier::rebinSpectra()
+{
+    // Reduces the stored magnitudes of the last analysis with the current bin size or scale, without transforming again
+    // Rows are shared among a pool of workers, each with its own prefix sums
+
+    analysis.binSize = frequencyBinSize;
+
+    designFilterBank(analysis);
+
+    std::vector<Real*> rows;
+    allocateSpectra(analysis, rows);
+
+    CompactMatrix *spectraData = analysis.channelSpectra.data();
+
+    int nSegments = analysis.nSegments;
+    int nRows = channels * nSegments;
+    int nThreads = Parallel::workerCount(nRows);
+
+    std::vector<double> maxPowers(static_cast<size_t>(nThreads), 0);
+
+    Parallel::run(nRows, nullptr, [this, &rows, spectraData, nSegments, &maxPowers](int t, Parallel::Items &items)
+    {
+        std::vector<double> prefix(static_cast<size_t>(analysis.nFrequencies));
+        std::vector<Real> componentRow(static_cast<size_t>(spectraData[0].columns()));
+
+        for (int row = items.next(); row >= 0; row = items.next())
+        {
+            const float *rowMagnitudes = analysis.magnitudes[static_cast<size_t>(row / nSegments)].row(row % nSegments);
+            Real *components = rows.empty() ? componentRow.data() : rows[static_cast<size_t>(row)];
+
+            double power = reduceMagnitudes(analysis, rowMagnitudes, prefix.data(), components);
+
+            if (rows.empty())
+            {
+                spectraData[row / nSegments].encodeRow(row % nSegments, components);
+            }
+
+            if (power > maxPowers[static_cast<size_t>(t)])
             {
-                supPower = sum;
+                maxPowers[static_cast<size_t>(t)] = power;
             }
         }
+    });
+
+    analysis.supPower = nThreads > 0 ? *std::max_element(maxPowers.begin(), maxPowers.end()) : 0;
+    supPower = analysis.supPower;
+
+    obtainFrequencies();
+    selectSpectraChannel(spectraChannel);
+}
+
+void Fourier::multiplyWindow(const Real * __restrict in, const Real * __restrict coefficients, Real * __restrict out, int n)
+{
+    // Non-aliasing pointers and a plain loop: the compiler vectorizes the multiply into the copy
+
+    for (int j = 0; j < n; j++)
+    {
+        out[j] = in[j] * coefficients[j];
+    }
+}
+
+QVector<Real> Fourier::windowFunction(Window type, int n, double beta)
+{
+    // Periodic windows, scaled by their coherent gain so that magnitudes stay comparable with the rectangular window
 
-        spectra.push_back(components);
+    QVector<Real> coefficients(n);
+
+    const double pi = 3.14159265358979323846;
+
+    double sum = 0;
+
+    for (int j = 0; j < n; j++)
+    {
+        double x = 2 * pi * j / n;
+        double w = 1;
+
+        switch (type)
+        {
+        case Rectangular:
+            w = 1;
+            break;
+        case Hann:
+            w = 0.5 - 0.5 * cos(x);
+            break;
+        case Hamming:
+            w = 0.54 - 0.46 * cos(x);
+            break;
+        case BlackmanHarris:
+            w = 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2 * x) - 0.01168 * cos(3 * x);
+            break;
+        case Kaiser:
+        {
+            double r = 2.0 * j / n - 1;
+            w = besselI0(beta * sqrt(std::max(0.0, 1 - r * r))) / besselI0(beta);
+            break;
+        }
+        }
+
+        coefficients[j] = static_cast<Real>(w);
+        sum += w;
+    }
+
+    double gain = n / sum;
+
+    for (Real &coefficient : coefficients)
+    {
+        coefficient = static_cast<Real>(coefficient * gain);
+    }
+
+    return coefficients;
+}
+
+double Fourier::besselI0(double x)
+{
+    // Power series of the zeroth order modified Bessel function of the first kind
+
+    double sum = 1;
+    double term = 1;
+
+    for (int k = 1; k < 50 && term > 1.0e-12 * sum; k++)
+    {
+        double factor = x / (2 * k);
+        term *= factor * factor;
+        sum += term;
+    }
+
+    return sum;
+}
+
+void Fourier::obtainFrequencies()
+{
+    if (analysis.filterBank.scale() != FilterBank::Linear)
+    {
+        frequencies = analysis.filterBank.centerFrequencies();
+        return;
+    }
+
+    int spectraBinSize = analysis.binSize;
+    int nFrequencyBins = static_cast<int>(ceil(static_cast<double>(analysis.nFrequencies - 1) / spectraBinSize));
+
+    double deltaF = frequencyStep();
+
+    frequencies.clear();
+    frequencies.reserve(nFrequencyBins);
 
-        step++;
-        emit(fftAnalysisStep(step));
+    for (int i = 0; i < nFrequencyBins; i++)
+    {
+        frequencies.push_back(((i + 1.0) * spectraBinSize - (spectraBinSize >> 1))* deltaF);
     }
+}
+
+void Fourier::obtainSpectra()
+{
+    supPower = analysis.supPower;
 
-    spectrum.clear();
-    spectrum.shrink_to_fit();
+    obtainFrequencies();
+
+    selectSpectraChannel(spectraChannel);
 
     emit(fftAnalysisPerformed());
 }
 
+void Fourier::selectSpectraChannel(int channel)
+{
+    // A single channel shares its rows, all channels are concatenated segment by segment
+
+    spectraChannel = channel;
+
+    const QVector<CompactMatrix> &channelSpectra = analysis.channelSpectra;
+
+    if (channelSpectra.isEmpty())
+    {
+        return;
+    }
+
+    if (channel >= 0 && channel < channelSpectra.size())
+    {
+        spectra = channelSpectra[channel];
+    }
+    else if (channelSpectra.size() == 1)
+    {
+        spectra = channelSpectra[0];
+    }
+    else
+    {
+        // Compact rows are encoded again with the scale of the whole concatenated row
+
+        int nSegments = channelSpectra[0].rows();
+        int nFrequencyBins = channelSpectra[0].columns();
+
+        CompactMatrix concatenated(channelSpectra[0].format(), nSegments, channelSpectra.size() * nFrequencyBins);
+
+        std::vector<Real> row(static_cast<size_t>(channelSpectra.size() * nFrequencyBins));
+        std::vector<Real> buffer(static_cast<size_t>(nFrequencyBins));
+
+        for (int i = 0; i < nSegments; i++)
+        {
+            Real *values = row.data();
+
+            for (const CompactMatrix &oneChannelSpectra : channelSpectra)
+            {
+                const Real *channelRow = oneChannelSpectra.row(i, buffer.data());
+                values = std::copy(channelRow, channelRow + nFrequencyBins, values);
+            }
+
+            concatenated.encodeRow(i, row.data());
+        }
+
+        spectra = concatenated;
+    }
+}
+
+int Fourier::samplesAlignment() const
+{
+    // Offset in samples of the first channel from FFTW's SIMD alignment
+
+    return samples.isEmpty() ? 0 : FFTW(alignment_of)(const_cast<Real*>(samples[0])) / static_cast<int>(sizeof(Real));
+}
+
+Matrix<float> Fourier::channelMagnitudes(int channel) const
+{
+    return channel >= 0 && channel < static_cast<int>(analysis.magnitudes.size()) ? analysis.magnitudes[static_cast<size_t>(channel)] : Matrix<float>();
+}
+
+qint64 Fourier::spectraBytes() const
+{
+    // Spectra of every channel of the displayed analysis, with their full resolution magnitudes
+
+    qint64 bytes = 0;
+
+    for (const CompactMatrix &oneChannelSpectra : analysis.channelSpectra)
+    {
+        bytes += oneChannelSpectra.bytes();
+    }
+
+    for (const Matrix<float> &oneChannelMagnitudes : analysis.magnitudes)
+    {
+        bytes += static_cast<qint64>(oneChannelMagnitudes.rows()) * oneChannelMagnitudes.stride() * static_cast<qint64>(sizeof(float));
+    }
+
+    return bytes;
+}
+
+double Fourier::frequencyStep() const
+{
+    return analysis.fftSize > 0 ? static_cast<double>(sampleRate) / analysis.fftSize : 0;
+}
+
+int Fourier::fftSize(int nSamples) const
+{
+    return padToSmoothSize ? FFTPlanner::smoothSize(nSamples) : nSamples;
+}
+
+int Fourier::displayedChannel() const
+{
+    return spectraChannel >= 0 && spectraChannel < channels ? spectraChannel : 0;
+}
 
 void Fourier::clearFFTData()
 {
     frequencies.clear();
     frequencies.shrink_to_fit();
     spectra.clear();
-    spectra.shrink_to_fit();
-}
-
-void Fourier::clearWaveFormData()
-{
-    times.clear();
-    times.shrink_to_fit();
+    analysis.channelSpectra.clear();
+    analysis.channelSpectra.squeeze();
+    analysis.magnitudes.clear();
+    analysis.magnitudes.shrink_to_fit();
+    resolutions.clear();
+    resolutions.shrink_to_fit();
 }
@@ -1,8 +1,16 @@
 #ifndef FOURIER_H
 #define FOURIER_H
 
+#include "precision.h"
+#include "fftPlanner.h"
+#include "filterBank.h"
+#include "matrix.h"
+#include "compactMatrix.h"
+#include "progress.h"
+#include "parallel.h"
 #include <QThread>
-#include <complex>
+#include <QFile>
+#include <vector>
 
 class Fourier : public QThread
 {
@@ -12,29 +20,80 @@ public:
     Fourier(QObject *parent = nullptr);
     ~Fourier() override;
 
+    enum Window
+    {
+        Rectangular,
+        Hann,
+        Hamming,
+        BlackmanHarris,
+        Kaiser
+    };
+
     int sampleRate;
     unsigned long sampleNumber;
     int milliseconds;
+    int hopMilliseconds;
+    Window window;
+    double kaiserBeta;
     int frequencyBinSize;
+    FilterBank::Scale scale;
+    int filterBands;
+    int bandsPerOctave;
+    bool padToSmoothSize;
+    QVector<int> extraDurations;
+    CompactMatrix::Format storageFormat;
     int duration;
-    QVector<double> waveForm;
-    QVector<double> times;
+    int channels;
+    bool keepChannels;
+    int analysisSampleRate;
+    double regionStart;
+    double regionEnd;
+    bool useCache;
+    qint64 cacheMaxBytes;
+    QVector<const Real*> samples;
     double minWaveForm;
     double maxWaveForm;
     double minTime;
     double maxTime;
-    QVector<QVector<double>> spectra;
+    CompactMatrix spectra;
+    int spectraChannel;
     QVector<double> frequencies;
     double supPower;
+    Progress progress;
 
     void clearFFTData();
-    void clearWaveFormData();
+    void selectSpectraChannel(int channel);
+    int displayedChannel() const;
+    FilterBank::Scale spectraScale() const { return analysis.filterBank.scale(); }
+    int samplesAlignment() const;
+    int fftSize(int nSamples) const;
+    bool writeBinaryDataFile(const QString filePath);
+    bool canRebinSpectra() const;
+    void rebinSpectra();
+
+    // Segment durations analysed along with the displayed one, which can be switched to without transforming again
+    QVector<int> precomputedDurations() const;
+    bool selectResolution(int duration);
+
+    // Full resolution magnitudes of the last analysis, segments by frequencies, empty if not kept
+    // The copy shares its storage and stays valid while a new analysis replaces it
+    Matrix<float> channelMagnitudes(int channel) const;
+    int segmentNumber() const { return analysis.nSegments; }
+    double frequencyStep() const;
+    qint64 spectraBytes() const;
+
+    void cancel();
+
+    // Shared with the live analysis
+    static void multiplyWindow(const Real * __restrict in, const Real * __restrict coefficients, Real * __restrict out, int n);
+    static QVector<Real> windowFunction(Window type, int n, double beta);
+    static double binMagnitudes(const float *rowMagnitudes, int nFrequencies, int binSize, double *prefix, Real *components);
 
 signals:
+    void loadFinished(int id);
     void fileRead();
     void fileDecodingFailed();
     void sendMessage(QString message);
-    void fftAnalysisStep(int step);
     void fftAnalysisPerformed();
 
 public slots:
@@ -45,11 +104,88 @@ public slots:
 protected:
     void run() override;
 
+private slots:
+    void publishLoadedFile(int id);
+
 private:
-    QVector<QVector<std::complex<double>>> spectrum;
-    int nFrequencies;
-    int step;
+    enum Task
+    {
+        ReadAudioFile,
+        ReadDataFile,
+        FFTAnalysis
+    };
+
+    struct LoadedFile
+    {
+        QVector<QVector<Real>> waveForms;
+        QFile *mappedFile;
+        QVector<const Real*> samples;
+        int sampleRate;
+        unsigned long sampleNumber;
+        double minWaveForm;
+        double maxWaveForm;
+        double startTime;
+    };
+
+    static const int chunkFrames = 65536;
+
+    Task task;
+    QString taskFilePath;
+    int loadId;
+
+    QVector<QVector<Real>> waveForms;
+    QFile *mappedFile;
+
+    // Spectra of one segment duration, with what is needed to reduce its magnitudes again
+    struct Resolution
+    {
+        int milliseconds;
+        int hopMilliseconds;
+        int nSamples;
+        int nHop;
+        int nSegments;
+        int binSize;
+        int fftSize;
+        int nFrequencies;
+        FilterBank filterBank;
+        QVector<Real> windowCoefficients;
+
+        // Window the segments were framed with, rectangular for constant-Q
+        Window window;
+        double kaiserBeta;
+        QVector<CompactMatrix> channelSpectra;
+        double supPower;
+
+        // Full resolution magnitudes, one row of nFrequencies per segment for each channel
+        // Not kept with compact spectra, which they would outweigh
+        std::vector<Matrix<float>> magnitudes;
+    };
+
+    // Plans and output rows of a resolution while it is analysed
+    struct Transform;
+
+    // Filled by the worker thread, published on the GUI thread once complete
+    LoadedFile loaded;
+
+    // The displayed resolution and the others computed with it
+    Resolution analysis;
+    std::vector<Resolution> resolutions;
 
+    void startTask(Task newTask, const QString filePath);
+    void decodeAudioFile(const QString filePath, int id);
+    void parseTextDataFile(const QString filePath, int id);
+    bool mapBinaryDataFile(const QString filePath, int id);
+    void regionFrames(int rate, quint64 totalFrames, quint64 &firstFrame, quint64 &frameCount) const;
+    void clearLoadedFile();
+    void releaseMappedFile();
+    void computeFFTs();
+    void setupResolution(Resolution &resolution, int duration, int hopDuration);
+    void transformBatches(const std::vector<Transform> &transforms, Parallel::Items &batches, double *maxPowers);
+    static double reduceMagnitudes(const Resolution &resolution, const float *rowMagnitudes, double *prefix, Real *components);
+    void designFilterBank(Resolution &resolution);
+    void allocateSpectra(Resolution &resolution, std::vector<Real*> &rows);
+    static double besselI0(double x);
+    void obtainFrequencies();
     void obtainSpectra();
 };
 
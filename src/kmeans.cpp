@@ -1,5 +1,7 @@
 #include "kmeans.h"
+#include <algorithm>
 #include <random>
+#include <vector>
 #include <math.h>
 
 KMeans::KMeans(QObject *parent) : QThread(parent)
@@ -14,7 +16,7 @@ KMeans::~KMeans()
     wait();
 }
 
-void KMeans::initData(QVector<QVector<double>> receivedData)
+void KMeans::initData(const CompactMatrix &receivedData)
 {
     data = receivedData;
 }
@@ -26,11 +28,14 @@ void KMeans::performKMeans()
 
 void KMeans::run()
 {
-    int dataSize = data.size();
-    int dim = data[0].size();
+    int dataSize = data.rows();
+    int dim = data.columns();
 
-    QVector<QVector<double>> centroids;
-    centroids.reserve(clusterNumber);
+    Matrix<double> centroids(clusterNumber, dim);
+
+    // Compact data are decoded a row at a time, just before use
+
+    std::vector<Real> buffer(static_cast<size_t>(dim));
 
     int chunk = (dataSize - 1) / clusterNumber;
 
@@ -40,7 +45,8 @@ void KMeans::run()
     for (int i = 0; i < clusterNumber; i++)
     {
         int j = i * chunk + distribution(generator);
-        centroids.push_back(data[j]);
+        const Real *point = data.row(j, buffer.data());
+        std::copy(point, point + dim, centroids.mutableRow(i));
     }
 
     clusterIndexes.clear();
@@ -55,8 +61,10 @@ void KMeans::run()
 
     bool iterate = true;
 
+    // Iterations run until no point changes cluster: no total
+
     int step = 0;
-    emit(kMeansIterationStep(step));
+    progress.start(0, "iterations");
 
     while (iterate)
     {
@@ -69,12 +77,14 @@ void KMeans::run()
 
         for (int i = 0; i < dataSize; i++)
         {
-            double minDistance = distance(data[i], centroids[0]);
+            const Real *point = data.row(i, buffer.data());
+
+            double minDistance = distance(point, centroids.row(0), dim);
             int c = 0;
 
             for (int j = 1; j < clusterNumber; j++)
             {
-                double dist = distanceCheck(data[i], centroids[j], minDistance);
+                double dist = distanceCheck(point, centroids.row(j), dim, minDistance);
                 if (dist < minDistance)
                 {
                     minDistance = dist;
@@ -92,7 +102,7 @@ void KMeans::run()
         }
 
         step++;
-        emit(kMeansIterationStep(step));
+        progress.setIteration(step);
 
         if (numClusterChanges == 0)
         {
@@ -101,25 +111,27 @@ void KMeans::run()
 
         for (int i = 0; i < clusterNumber; i++)
         {
-            for (int j = 0; j < dim; j++)
-            {
-                centroids[i][j] = 0;
-            }
+            std::fill(centroids.mutableRow(i), centroids.mutableRow(i) + dim, 0.0);
         }
 
         for (int i = 0; i < dataSize; i++)
         {
+            const Real *point = data.row(i, buffer.data());
+            double *centroid = centroids.mutableRow(clusterIndexes[i]);
+
             for (int j = 0; j < dim; j++)
             {
-                centroids[clusterIndexes[i]][j] += data[i][j];
+                centroid[j] += point[j];
             }
         }
 
         for (int i = 0; i < clusterNumber; i++)
         {
+            double *centroid = centroids.mutableRow(i);
+
             for (int j = 0; j < dim; j++)
             {
-                centroids[i][j] /= clusterCount[i];
+                centroid[j] /= clusterCount[i];
             }
         }
     }
@@ -129,7 +141,8 @@ void KMeans::run()
     computeClusterLengthHistogram();
 
     data.clear();
-    data.shrink_to_fit();
+
+    progress.finish();
 
     emit(kMeansPerformed());
 }
@@ -220,7 +233,7 @@ void KMeans::computeClusterLengthHistogram()
 
                 index = i;
 
-                if (i == data.size() - 1)
+                if (i == clusterIndexes.size() - 1)
                 {
                     iterate = false;
                 }
@@ -298,11 +311,11 @@ void KMeans::computeClusterLengthHistogram()
     }
 }
 
-double KMeans::distance(const QVector<double> &vector1, const QVector<double> &vector2)
+double KMeans::distance(const Real *vector1, const double *vector2, int dim)
 {
     double dist = 0;
 
-    for (int i = 0; i < vector1.size(); i++)
+    for (int i = 0; i < dim; i++)
     {
         double diff = vector1[i] - vector2[i];
         dist += diff * diff;
@@ -311,11 +324,11 @@ double KMeans::distance(const QVector<double> &vector1, const QVector<double> &v
     return dist;
 }
 
-double KMeans::distanceCheck(const QVector<double> &vector1, const QVector<double> &vector2, const double &minDistance)
+double KMeans::distanceCheck(const Real *vector1, const double *vector2, int dim, const double &minDistance)
 {
     double dist = 0;
 
-    for (int i = 0; i < vector1.size(); i++)
+    for (int i = 0; i < dim; i++)
     {
         double diff = vector1[i] - vector2[i];
         dist += diff * diff;
@@ -1,6 +1,10 @@
 #ifndef KMEANS_H
 #define KMEANS_H
 
+#include "precision.h"
+#include "matrix.h"
+#include "compactMatrix.h"
+#include "progress.h"
 #include <QThread>
 
 class KMeans : public QThread
@@ -19,26 +23,26 @@ public:
     QVector<double> lengths;
     QVector<double> clusterLengthHistogram;
     double clusterLengthHistogramMax;
+    Progress progress;
 
-    void initData(QVector<QVector<double>> receivedData);
+    void initData(const CompactMatrix &receivedData);
     void performKMeans();
     void clearKMeansData();
 
 signals:
-    void kMeansIterationStep(int step);
     void kMeansPerformed();
 
 protected:
     void run() override;
 
 private:
-    QVector<QVector<double>> data;
+    CompactMatrix data;
 
     void computeClusterHistogram(QVector<int> clusterCount);
     void reassignClusterIndexes();
     void computeClusterLengthHistogram();
-    double distance(const QVector<double> &vector1, const QVector<double> &vector2);
-    double distanceCheck(const QVector<double> &vector1, const QVector<double> &vector2, const double &minDistance);
+    static double distance(const Real *vector1, const double *vector2, int dim);
+    static double distanceCheck(const Real *vector1, const double *vector2, int dim, const double &minDistance);
 };
 
 #endif
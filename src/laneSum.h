@@ -0,0 +1,47 @@
+#ifndef LANESUM_H
+#define LANESUM_H
+
+// Sums over many elements, the kernels of spectral reductions and filter banks.
+// Terms are split over independent lanes, which compilers keep in vector registers without reassociating.
+// The lanes are added last, in a fixed order, so results do not depend on the compiler or the instruction set.
+
+constexpr int sumLanes = 8;
+
+// Sum of term(k) for k from 0 to n - 1, accumulated in T
+
+template <typename T, typename Term>
+inline T laneSum(int n, Term term)
+{
+    T sums[sumLanes] = {};
+
+    int k = 0;
+
+    for (; k + sumLanes <= n; k += sumLanes)
+    {
+        for (int l = 0; l < sumLanes; l++)
+        {
+            sums[l] += term(k + l);
+        }
+    }
+
+    T sum = 0;
+
+    for (; k < n; k++)
+    {
+        sum += term(k);
+    }
+
+    for (int l = 0; l < sumLanes; l++)
+    {
+        sum += sums[l];
+    }
+
+    return sum;
+}
+
+inline float laneDot(const float * __restrict a, const float * __restrict b, int n)
+{
+    return laneSum<float>(n, [a, b](int k){ return a[k] * b[k]; });
+}
+
+#endif
@@ -0,0 +1,378 @@
+#include "liveAnalyzer.h"
+#include "miniaudio.h"
+#include <QMutexLocker>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+struct LiveAnalyzer::Device
+{
+    ma_context context;
+    ma_device device;
+    ma_pcm_rb ringBuffer;
+
+    static void onData(ma_device *pDevice, void *pOutput, const void *pInput, ma_uint32 frameCount);
+};
+
+void LiveAnalyzer::Device::onData(ma_device *pDevice, void *pOutput, const void *pInput, ma_uint32 frameCount)
+{
+    // Runs on the device thread: copies into the ring buffer without locking or allocating
+    // Frames that do not fit are dropped, the analysis thread skips ahead when it falls behind anyway
+
+    Q_UNUSED(pOutput)
+
+    LiveAnalyzer *analyzer = static_cast<LiveAnalyzer*>(pDevice->pUserData);
+    ma_pcm_rb *ringBuffer = &analyzer->device->ringBuffer;
+
+    const float *frames = static_cast<const float*>(pInput);
+
+    while (frameCount > 0)
+    {
+        ma_uint32 count = frameCount;
+        void *buffer = nullptr;
+
+        if (ma_pcm_rb_acquire_write(ringBuffer, &count, &buffer) != MA_SUCCESS || count == 0)
+        {
+            break;
+        }
+
+        std::copy(frames, frames + count, static_cast<float*>(buffer));
+        ma_pcm_rb_commit_write(ringBuffer, count, buffer);
+
+        frames += count;
+        frameCount -= count;
+
+        analyzer->capturedFrames += count;
+    }
+
+    analyzer->lastCaptureTime = analyzer->clock.nsecsElapsed();
+}
+
+LiveAnalyzer::LiveAnalyzer(QObject *parent) : QThread(parent)
+{
+    milliseconds = 100;
+    hopMilliseconds = 100;
+    window = Fourier::Hann;
+    kaiserBeta = 8.6;
+    frequencyBinSize = 1;
+    padToSmoothSize = false;
+    scale = FilterBank::Linear;
+    filterBands = 40;
+    bandsPerOctave = 12;
+    nullBackend = false;
+    fftSize = 0;
+    sampleRate = 0;
+    deviceLatency = 0;
+    device = nullptr;
+    capturedFrames = 0;
+    lastCaptureTime = 0;
+}
+
+LiveAnalyzer::~LiveAnalyzer()
+{
+    stopCapture();
+}
+
+bool LiveAnalyzer::isCapturing() const
+{
+    return device != nullptr;
+}
+
+qint64 LiveAnalyzer::elapsed() const
+{
+    return clock.nsecsElapsed();
+}
+
+double LiveAnalyzer::hopSeconds() const
+{
+    return sampleRate > 0 ? static_cast<double>(std::max(1, sampleRate * hopMilliseconds / 1000)) / sampleRate : hopMilliseconds / 1000.0;
+}
+
+bool LiveAnalyzer::startCapture()
+{
+    stopCapture();
+
+    device = new Device;
+
+    // The null backend produces silence at a steady rate, for testing without audio hardware
+
+    ma_backend backends[] = { ma_backend_null };
+
+    if (ma_context_init(nullBackend ? backends : nullptr, nullBackend ? 1 : 0, nullptr, &device->context) != MA_SUCCESS)
+    {
+        delete device;
+        device = nullptr;
+
+        emit(captureFailed("No audio backend available."));
+        return false;
+    }
+
+    // Mono at the device's own rate, with buffers as small as the backend allows
+
+    ma_device_config config = ma_device_config_init(ma_device_type_capture);
+    config.capture.format = ma_format_f32;
+    config.capture.channels = 1;
+    config.sampleRate = 0;
+    config.performanceProfile = ma_performance_profile_low_latency;
+    config.dataCallback = Device::onData;
+    config.pUserData = this;
+
+    if (ma_device_init(&device->context, &config, &device->device) != MA_SUCCESS)
+    {
+        ma_context_uninit(&device->context);
+        delete device;
+        device = nullptr;
+
+        emit(captureFailed("Could not open the capture device."));
+        return false;
+    }
+
+    sampleRate = static_cast<int>(device->device.sampleRate);
+    deviceLatency = 1000.0 * device->device.capture.internalBufferSizeInFrames / device->device.capture.internalSampleRate;
+
+    // Room for a second or four segments, whichever is longer
+
+    int nSamples = sampleRate * milliseconds / 1000;
+
+    if (nSamples < 2 || ma_pcm_rb_init(ma_format_f32, 1, static_cast<ma_uint32>(std::max(sampleRate, 4 * nSamples)), nullptr, &device->ringBuffer) != MA_SUCCESS)
+    {
+        ma_device_uninit(&device->device);
+        ma_context_uninit(&device->context);
+        delete device;
+        device = nullptr;
+
+        emit(captureFailed("Could not allocate the capture buffer."));
+        return false;
+    }
+
+    // Bank and frequencies as in the analysis of a file, on the grid of the padded transform
+
+    fftSize = padToSmoothSize ? FFTPlanner::smoothSize(nSamples) : nSamples;
+
+    filterBank.design(scale, fftSize, nSamples, sampleRate, filterBands, bandsPerOctave);
+
+    if (filterBank.bandNumber() == 0)
+    {
+        filterBank.design(FilterBank::Linear, fftSize, nSamples, sampleRate, filterBands, bandsPerOctave);
+    }
+
+    frequencies.clear();
+
+    if (filterBank.scale() != FilterBank::Linear)
+    {
+        frequencies = filterBank.centerFrequencies();
+    }
+    else
+    {
+        double deltaF = static_cast<double>(sampleRate) / fftSize;
+        int nFrequencyBins = static_cast<int>(ceil(static_cast<double>(fftSize / 2) / frequencyBinSize));
+
+        for (int i = 0; i < nFrequencyBins; i++)
+        {
+            frequencies.push_back(((i + 1.0) * frequencyBinSize - (frequencyBinSize >> 1)) * deltaF);
+        }
+    }
+
+    rows.clear();
+    capturedFrames = 0;
+    lastCaptureTime = 0;
+
+    clock.start();
+
+    start();
+
+    if (ma_device_start(&device->device) != MA_SUCCESS)
+    {
+        stopCapture();
+
+        emit(captureFailed("Could not start the capture device."));
+        return false;
+    }
+
+    return true;
+}
+
+void LiveAnalyzer::stopCapture()
+{
+    if (device == nullptr)
+    {
+        return;
+    }
+
+    // The device stops calling back before the ring buffer goes away
+
+    ma_device_uninit(&device->device);
+
+    requestInterruption();
+    wait();
+
+    ma_pcm_rb_uninit(&device->ringBuffer);
+    ma_context_uninit(&device->context);
+
+    delete device;
+    device = nullptr;
+}
+
+QVector<LiveAnalyzer::Row> LiveAnalyzer::takeRows()
+{
+    QMutexLocker locker(&rowsMutex);
+
+    QVector<Row> taken;
+    taken.swap(rows);
+
+    return taken;
+}
+
+qint64 LiveAnalyzer::captureTime(quint64 frame) const
+{
+    // Frames up to the last one pushed arrived together, earlier ones one sample period apart before
+
+    quint64 frames = capturedFrames;
+    qint64 time = lastCaptureTime;
+
+    if (frame + 1 >= frames)
+    {
+        return time;
+    }
+
+    return time - static_cast<qint64>((frames - 1 - frame) * Q_UINT64_C(1000000000) / static_cast<quint64>(sampleRate));
+}
+
+void LiveAnalyzer::run()
+{
+    int nSamples = sampleRate * milliseconds / 1000;
+    int nHop = std::max(1, sampleRate * hopMilliseconds / 1000);
+    int nFrequencies = fftSize / 2 + 1;
+
+    FFTPlanner::Plans plans;
+    FFTPlanner::createPlans(fftSize, fftSize, 1, 0, plans);
+
+    // Constant-Q kernels carry their own window, segments are then framed rectangular
+
+    bool windowed = window != Fourier::Rectangular && !filterBank.isComplex();
+
+    QVector<Real> coefficients = windowed ? Fourier::windowFunction(window, nSamples, kaiserBeta) : QVector<Real>();
+
+    // The padding stays zero: frames only overwrite their first nSamples values, the transform preserves its input
+
+    Real *in = FFTW(alloc_real)(static_cast<unsigned long>(fftSize));
+    FFTW(complex) *out = FFTW(alloc_complex)(static_cast<unsigned long>(nFrequencies));
+
+    std::fill(in, in + fftSize, static_cast<Real>(0));
+
+    std::vector<float> magnitudes(static_cast<size_t>(nFrequencies));
+    std::vector<double> prefix(static_cast<size_t>(nFrequencies));
+    QVector<Real> components(frequencies.size());
+
+    // Frames read and not yet consumed, the first of them being frame historyStart since capture began
+
+    std::vector<Real> history;
+    quint64 historyStart = 0;
+    quint64 segmentStart = 0;
+
+    while (!isInterruptionRequested())
+    {
+        ma_uint32 count = ma_pcm_rb_available_read(&device->ringBuffer);
+
+        while (count > 0)
+        {
+            void *buffer = nullptr;
+
+            if (ma_pcm_rb_acquire_read(&device->ringBuffer, &count, &buffer) != MA_SUCCESS || count == 0)
+            {
+                break;
+            }
+
+            const float *frames = static_cast<const float*>(buffer);
+            history.insert(history.end(), frames, frames + count);
+
+            ma_pcm_rb_commit_read(&device->ringBuffer, count, buffer);
+
+            count = ma_pcm_rb_available_read(&device->ringBuffer);
+        }
+
+        quint64 historyEnd = historyStart + history.size();
+
+        // More than a segment behind: skip to the newest complete segment on the hop grid, latency stays bounded
+
+        if (historyEnd >= segmentStart + 2 * static_cast<quint64>(nSamples))
+        {
+            segmentStart += (historyEnd - nSamples - segmentStart) / nHop * nHop;
+        }
+
+        bool analysed = false;
+
+        while (segmentStart + nSamples <= historyEnd)
+        {
+            const Real *segment = history.data() + (segmentStart - historyStart);
+
+            if (windowed)
+            {
+                Fourier::multiplyWindow(segment, coefficients.constData(), in, nSamples);
+            }
+            else
+            {
+                std::copy(segment, segment + nSamples, in);
+            }
+
+            FFTW(execute_dft_r2c)(plans.batch, in, out);
+
+            if (filterBank.isComplex())
+            {
+                filterBank.apply(out, components.data());
+            }
+            else
+            {
+                for (int k = 0; k < nFrequencies; k++)
+                {
+                    magnitudes[static_cast<size_t>(k)] = static_cast<float>(sqrt(static_cast<double>(out[k][0]) * out[k][0] + static_cast<double>(out[k][1]) * out[k][1]));
+                }
+
+                if (filterBank.scale() == FilterBank::Linear)
+                {
+                    Fourier::binMagnitudes(magnitudes.data(), nFrequencies, frequencyBinSize, prefix.data(), components.data());
+                }
+                else
+                {
+                    filterBank.apply(magnitudes.data(), components.data());
+                }
+            }
+
+            Row row;
+            row.power = QVector<double>(components.begin(), components.end());
+            row.time = (segmentStart + nSamples / 2.0) / sampleRate;
+            row.captureTime = captureTime(segmentStart + nSamples - 1);
+
+            {
+                QMutexLocker locker(&rowsMutex);
+
+                if (rows.size() == maxPendingRows)
+                {
+                    rows.removeFirst();
+                }
+
+                rows.push_back(row);
+            }
+
+            segmentStart += nHop;
+            analysed = true;
+        }
+
+        // Drop frames no segment needs any more
+
+        quint64 keepFrom = std::min(segmentStart, historyEnd);
+
+        history.erase(history.begin(), history.begin() + static_cast<qint64>(keepFrom - historyStart));
+        historyStart = keepFrom;
+
+        if (!analysed)
+        {
+            msleep(1);
+        }
+    }
+
+    FFTW(free)(in);
+    FFTW(free)(out);
+
+    FFTPlanner::destroyPlans(plans);
+}
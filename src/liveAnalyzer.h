@@ -0,0 +1,83 @@
+#ifndef LIVEANALYZER_H
+#define LIVEANALYZER_H
+
+#include "precision.h"
+#include "fourier.h"
+#include <QThread>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <atomic>
+
+// Analyses a capture device while it records.
+// The device callback pushes frames into a lock-free ring buffer. The thread transforms and reduces each segment
+// as soon as its last frame arrives, in the same way as the analysis of a file: same window, padding, bins or bands.
+// Rows are collected for the GUI thread to take, stamped with the time their last frame was captured.
+
+class LiveAnalyzer : public QThread
+{
+    Q_OBJECT
+
+public:
+    LiveAnalyzer(QObject *parent = nullptr);
+    ~LiveAnalyzer() override;
+
+    struct Row
+    {
+        QVector<double> power;
+        double time;
+        qint64 captureTime;
+    };
+
+    int milliseconds;
+    int hopMilliseconds;
+    Fourier::Window window;
+    double kaiserBeta;
+    int frequencyBinSize;
+    bool padToSmoothSize;
+    FilterBank::Scale scale;
+    int filterBands;
+    int bandsPerOctave;
+    bool nullBackend;
+
+    // Set by startCapture: bin or band frequencies of the rows, and the scale, linear if no band fits a segment
+    int sampleRate;
+    QVector<double> frequencies;
+    double deviceLatency;
+
+    FilterBank::Scale spectraScale() const { return filterBank.scale(); }
+    double hopSeconds() const;
+
+    bool startCapture();
+    void stopCapture();
+    bool isCapturing() const;
+    QVector<Row> takeRows();
+    qint64 elapsed() const;
+
+signals:
+    void captureFailed(QString message);
+
+protected:
+    void run() override;
+
+private:
+    struct Device;
+
+    static const int maxPendingRows = 1024;
+
+    Device *device;
+    QElapsedTimer clock;
+
+    int fftSize;
+    FilterBank filterBank;
+
+    // Written by the device callback: frames pushed so far and the time of the last push
+    std::atomic<quint64> capturedFrames;
+    std::atomic<qint64> lastCaptureTime;
+
+    QMutex rowsMutex;
+    QVector<Row> rows;
+
+    qint64 captureTime(quint64 frame) const;
+};
+
+#endif
@@ -5,6 +5,7 @@
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    a.setApplicationName("PitchExplorer");
     MainWindow w;
     w.show();
     return a.exec();
@@ -9,23 +9,114 @@
 
 MainWindow::MainWindow(QWidget *parent): QWidget(parent)
 {
+    planner = new FFTPlanner;
     fourier = new Fourier;
+    liveAnalyzer = new LiveAnalyzer;
     pca = new PCA;
     kmeans = new KMeans;
     hurst = new Hurst;
+    pitch = new Pitch;
+    spectralFeatures = new SpectralFeatures;
 
     currentClusterButton = nullptr;
+    audioFileSelected = false;
+    loadPending = false;
+    samplesShown = false;
+
+    liveSpectrogramData = nullptr;
+    liveSupPower = 0;
 
     milliseconds = fourier->milliseconds;
+    hopMilliseconds = fourier->hopMilliseconds;
 
     // Load audio file button
 
     loadAudioFileButton = new QPushButton("Load audio file");
     loadAudioFileButton->setToolTip("WAV, MP3, FLAC");
 
+    // Keep channels check box
+
+    keepChannelsCheckBox = new QCheckBox("Keep channels", this);
+    keepChannelsCheckBox->setToolTip("Analyze each channel of the audio file instead of a mono downmix");
+    keepChannelsCheckBox->setChecked(fourier->keepChannels);
+
+    // Analysis sample rate combo box
+
+    analysisSampleRateComboBox = new QComboBox;
+    analysisSampleRateComboBox->setToolTip("Resample audio files while decoding");
+    analysisSampleRateComboBox->addItem("Original rate", 0);
+
+    for (int rate : { 8000, 11025, 16000, 22050, 32000, 44100, 48000 })
+    {
+        analysisSampleRateComboBox->addItem(QString("%1Hz").arg(rate), rate);
+    }
+
+    analysisSampleRateComboBox->setCurrentIndex(analysisSampleRateComboBox->findData(fourier->analysisSampleRate));
+
     // Load data file button
 
     loadDataFileButton = new QPushButton("Load data file");
+    loadDataFileButton->setToolTip("Text: sample rate then one sample per line\nBinary: PXD");
+
+    // Export binary data file button
+
+    exportBinaryDataFileButton = new QPushButton("Export binary data");
+    exportBinaryDataFileButton->setToolTip("Save loaded samples as a memory-mappable PXD file");
+    exportBinaryDataFileButton->setEnabled(false);
+
+    // Region of interest
+
+    regionStartSpinBox = new QDoubleSpinBox;
+    regionStartSpinBox->setRange(0, 86400);
+    regionStartSpinBox->setDecimals(1);
+    regionStartSpinBox->setSuffix(" s");
+    regionStartSpinBox->setToolTip("Start of the region to analyze");
+    regionStartSpinBox->setValue(fourier->regionStart);
+
+    regionEndSpinBox = new QDoubleSpinBox;
+    regionEndSpinBox->setRange(0, 86400);
+    regionEndSpinBox->setDecimals(1);
+    regionEndSpinBox->setSuffix(" s");
+    regionEndSpinBox->setSpecialValueText("End");
+    regionEndSpinBox->setToolTip("End of the region to analyze");
+    regionEndSpinBox->setValue(fourier->regionEnd);
+
+    QGroupBox *regionGroupBox = new QGroupBox("Region");
+
+    QVBoxLayout *regionLayout = new QVBoxLayout;
+
+    regionLayout->addWidget(regionStartSpinBox);
+    regionLayout->addWidget(regionEndSpinBox);
+
+    regionGroupBox->setLayout(regionLayout);
+
+    // Decoded audio cache
+
+    useCacheCheckBox = new QCheckBox("Cache decoded audio", this);
+    useCacheCheckBox->setToolTip("Reopen audio files from a memory-mapped copy of their decoded samples");
+    useCacheCheckBox->setChecked(fourier->useCache);
+
+    cacheLimitSpinBox = new QSpinBox;
+    cacheLimitSpinBox->setRange(0, 1000000);
+    cacheLimitSpinBox->setSingleStep(256);
+    cacheLimitSpinBox->setPrefix("Limit: ");
+    cacheLimitSpinBox->setSuffix(" MB");
+    cacheLimitSpinBox->setValue(static_cast<int>(fourier->cacheMaxBytes >> 20));
+
+    cacheSizeLabel = new QLabel(this);
+
+    clearCacheButton = new QPushButton("Clear cache");
+
+    QGroupBox *cacheGroupBox = new QGroupBox("Cache");
+
+    QVBoxLayout *cacheLayout = new QVBoxLayout;
+
+    cacheLayout->addWidget(useCacheCheckBox);
+    cacheLayout->addWidget(cacheLimitSpinBox);
+    cacheLayout->addWidget(cacheSizeLabel);
+    cacheLayout->addWidget(clearCacheButton);
+
+    cacheGroupBox->setLayout(cacheLayout);
 
     // About button
 
@@ -55,12 +146,48 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
 
     playerGroupBox->setLayout(playerLayout);
 
+    // Live input
+
+    QGroupBox *liveGroupBox = new QGroupBox("Live");
+
+    QVBoxLayout *liveLayout = new QVBoxLayout;
+
+    liveInputButton = new QPushButton("Live input");
+    liveInputButton->setCheckable(true);
+    liveInputButton->setToolTip("Analyze the default capture device with the current FFT settings");
+
+    latencyLabel = new QLabel(this);
+    latencyLabel->setText("Latency: -");
+    latencyLabel->setToolTip("From the capture of the last frame of a segment to its plot, including the device buffer");
+
+    liveLayout->addWidget(liveInputButton);
+    liveLayout->addWidget(latencyLabel);
+
+    liveLayout->setAlignment(Qt::AlignCenter);
+
+    liveGroupBox->setLayout(liveLayout);
+
+    // Graphs are refreshed at most 30 times per second, whatever the hop
+
+    liveTimer = new QTimer(this);
+    liveTimer->setInterval(33);
+
+    progressTimer = new QTimer(this);
+    progressTimer->setInterval(33);
+
+    // The null backend captures silence, set PITCHEXPLORER_NULL_AUDIO to test without audio hardware
+
+    liveAnalyzer->nullBackend = qEnvironmentVariableIsSet("PITCHEXPLORER_NULL_AUDIO");
+
     // Action buttons layout 0
 
     QVBoxLayout *actionButtonsLayout0 = new QVBoxLayout;
 
     actionButtonsLayout0->addWidget(loadAudioFileButton);
+    actionButtonsLayout0->addWidget(keepChannelsCheckBox);
+    actionButtonsLayout0->addWidget(analysisSampleRateComboBox);
     actionButtonsLayout0->addWidget(loadDataFileButton);
+    actionButtonsLayout0->addWidget(exportBinaryDataFileButton);
 
     // Action buttons layout 1
 
@@ -74,8 +201,11 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
     QHBoxLayout *mainButtonsLayout = new QHBoxLayout;
 
     mainButtonsLayout->addLayout(actionButtonsLayout0);
+    mainButtonsLayout->addWidget(regionGroupBox);
+    mainButtonsLayout->addWidget(cacheGroupBox);
     mainButtonsLayout->addLayout(actionButtonsLayout1);
     mainButtonsLayout->addWidget(playerGroupBox);
+    mainButtonsLayout->addWidget(liveGroupBox);
 
     // FFT analysis
 
@@ -85,6 +215,10 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
     samplesPerSegmentLabel = new QLabel(this);
     samplesPerSegmentLabel->setText("Samples/segment: 0");
 
+    fftSizeLabel = new QLabel(this);
+    fftSizeLabel->setText("FFT size: 0");
+    fftSizeLabel->setToolTip("Transform size and its predicted cost relative to n log2(n), about 1 for powers of two");
+
     segmentsLabel = new QLabel(this);
     segmentsLabel->setText("Segments: 0");
 
@@ -94,6 +228,10 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
     frequencyBinsLabel = new QLabel(this);
     frequencyBinsLabel->setText("Frequency bins: 0");
 
+    spectraSizeLabel = new QLabel(this);
+    spectraSizeLabel->setText("Spectra: 0 MB");
+    spectraSizeLabel->setToolTip("Memory held by the spectra of the last analysis, with their full resolution magnitudes");
+
     QLabel *segmentDurationLabel = new QLabel("Segment duration (ms):");
     segmentDurationSpinBox = new QSpinBox;
     segmentDurationSpinBox->setRange(1, 10000);
@@ -102,6 +240,46 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
     segmentDurationSpinBox->setEnabled(false);
     segmentDurationSpinBox->setMaximumWidth(100);
 
+    QLabel *hopLabel = new QLabel("Hop size (ms):");
+    hopSpinBox = new QSpinBox;
+    hopSpinBox->setRange(1, 10000);
+    hopSpinBox->setSingleStep(1);
+    hopSpinBox->setValue(fourier->hopMilliseconds);
+    hopSpinBox->setToolTip("Time between the starts of consecutive segments, segments overlap if shorter than their duration");
+    hopSpinBox->setEnabled(false);
+    hopSpinBox->setMaximumWidth(100);
+
+    QLabel *extraDurationsLabel = new QLabel("Also compute (ms):");
+    extraDurationsLineEdit = new QLineEdit;
+    extraDurationsLineEdit->setPlaceholderText("50, 100, 500");
+    extraDurationsLineEdit->setToolTip("Further segment durations analysed in parallel with the current one, shown at once when the segment duration is set to one of them");
+    extraDurationsLineEdit->setMaximumWidth(100);
+
+    QLabel *windowLabel = new QLabel("Window:");
+    windowComboBox = new QComboBox;
+    windowComboBox->addItem("Rectangular", Fourier::Rectangular);
+    windowComboBox->addItem("Hann", Fourier::Hann);
+    windowComboBox->addItem("Hamming", Fourier::Hamming);
+    windowComboBox->addItem("Blackman-Harris", Fourier::BlackmanHarris);
+    windowComboBox->addItem("Kaiser", Fourier::Kaiser);
+    windowComboBox->setCurrentIndex(windowComboBox->findData(fourier->window));
+    windowComboBox->setMaximumWidth(100);
+    windowComboBox->setEnabled(fourier->scale != FilterBank::ConstantQ);
+
+    padCheckBox = new QCheckBox("Pad to fast size", this);
+    padCheckBox->setToolTip("Zero-pad segments to the next size with no prime factor above 7, keeping their duration");
+    padCheckBox->setChecked(fourier->padToSmoothSize);
+
+    QLabel *storageLabel = new QLabel("Spectra storage:");
+    storageComboBox = new QComboBox;
+    storageComboBox->addItem("Full precision", CompactMatrix::Full);
+    storageComboBox->addItem("Float16", CompactMatrix::Float16);
+    storageComboBox->addItem("Log 16-bit", CompactMatrix::Log16);
+    storageComboBox->addItem("Log 8-bit", CompactMatrix::Log8);
+    storageComboBox->setCurrentIndex(storageComboBox->findData(fourier->storageFormat));
+    storageComboBox->setToolTip("Compact storage for long recordings, relative error per value: Float16 0.05%, Log 16-bit 0.02%, Log 8-bit 2.2%\nCompact spectra need a new analysis to change bin size or scale, and cannot give spectral features");
+    storageComboBox->setMaximumWidth(100);
+
     QLabel *frequencyBinSizeLabel = new QLabel("Frequency bin size:");
     frequencyBinSizeSpinBox = new QSpinBox;
     frequencyBinSizeSpinBox->setRange(1, 1000);
@@ -110,6 +288,41 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
     frequencyBinSizeSpinBox->setEnabled(false);
     frequencyBinSizeSpinBox->setMaximumWidth(100);
 
+    QLabel *scaleLabel = new QLabel("Frequency scale:");
+    scaleComboBox = new QComboBox;
+    scaleComboBox->addItem("Linear", FilterBank::Linear);
+    scaleComboBox->addItem("Mel", FilterBank::Mel);
+    scaleComboBox->addItem("Bark", FilterBank::Bark);
+    scaleComboBox->addItem("Logarithmic", FilterBank::Logarithmic);
+    scaleComboBox->addItem("Constant-Q", FilterBank::ConstantQ);
+    scaleComboBox->setCurrentIndex(scaleComboBox->findData(fourier->scale));
+    scaleComboBox->setToolTip("Linear frequency bins, or bands of a filter bank with far fewer dimensions");
+    scaleComboBox->setMaximumWidth(100);
+
+    QLabel *filterBandsLabel = new QLabel("Bands:");
+    filterBandsSpinBox = new QSpinBox;
+    filterBandsSpinBox->setRange(2, 512);
+    filterBandsSpinBox->setSingleStep(1);
+    filterBandsSpinBox->setValue(fourier->filterBands);
+    filterBandsSpinBox->setToolTip("Number of mel or Bark bands");
+    filterBandsSpinBox->setEnabled(fourier->scale == FilterBank::Mel || fourier->scale == FilterBank::Bark);
+    filterBandsSpinBox->setMaximumWidth(100);
+
+    QLabel *bandsPerOctaveLabel = new QLabel("Bands/octave:");
+    bandsPerOctaveSpinBox = new QSpinBox;
+    bandsPerOctaveSpinBox->setRange(1, 96);
+    bandsPerOctaveSpinBox->setSingleStep(1);
+    bandsPerOctaveSpinBox->setValue(fourier->bandsPerOctave);
+    bandsPerOctaveSpinBox->setToolTip("Resolution of logarithmic and constant-Q bands, which start at the lowest frequency a segment resolves");
+    bandsPerOctaveSpinBox->setEnabled(fourier->scale == FilterBank::Logarithmic || fourier->scale == FilterBank::ConstantQ);
+    bandsPerOctaveSpinBox->setMaximumWidth(100);
+
+    QLabel *channelLabel = new QLabel("Channel:");
+    channelComboBox = new QComboBox;
+    channelComboBox->setToolTip("Channel shown and fed to PCA and K-Means, or all channels concatenated");
+    channelComboBox->setEnabled(false);
+    channelComboBox->setMaximumWidth(100);
+
     startFFTAnalysisButton = new QPushButton("Start FFT analysis");
     startFFTAnalysisButton->setEnabled(false);
 
@@ -134,6 +347,50 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
     QGroupBox *axesScaleGroupBox = new QGroupBox("Spectrum graph");
     axesScaleGroupBox->setLayout(axesScaleLayout);
 
+    // Background planning
+
+    prePlanCheckBox = new QCheckBox("Pre-plan FFTs", this);
+    prePlanCheckBox->setToolTip("Plan common segment durations in the background once a file is loaded");
+    prePlanCheckBox->setChecked(true);
+
+    // Pitch tracking
+
+    QLabel *minPitchLabel = new QLabel("Min. frequency (Hz):");
+    minPitchSpinBox = new QSpinBox;
+    minPitchSpinBox->setRange(20, 2000);
+    minPitchSpinBox->setSingleStep(10);
+    minPitchSpinBox->setValue(pitch->minFrequency);
+    minPitchSpinBox->setToolTip("Lowest fundamental frequency searched, at least two periods must fit in a segment");
+    minPitchSpinBox->setMaximumWidth(100);
+
+    QLabel *maxPitchLabel = new QLabel("Max. frequency (Hz):");
+    maxPitchSpinBox = new QSpinBox;
+    maxPitchSpinBox->setRange(40, 5000);
+    maxPitchSpinBox->setSingleStep(10);
+    maxPitchSpinBox->setValue(pitch->maxFrequency);
+    maxPitchSpinBox->setMaximumWidth(100);
+
+    trackPitchButton = new QPushButton("Track pitch");
+    trackPitchButton->setToolTip("Estimate the fundamental frequency of each segment of the displayed channel");
+    trackPitchButton->setEnabled(false);
+
+    pitchProgressBar = new QProgressBar;
+    pitchProgressBar->setRange(0, 10);
+    pitchProgressBar->setValue(0);
+    pitchProgressBar->setTextVisible(true);
+    pitchProgressBar->setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Fixed);
+
+    QVBoxLayout *pitchLayout = new QVBoxLayout;
+    pitchLayout->addWidget(minPitchLabel);
+    pitchLayout->addWidget(minPitchSpinBox);
+    pitchLayout->addWidget(maxPitchLabel);
+    pitchLayout->addWidget(maxPitchSpinBox);
+    pitchLayout->addWidget(trackPitchButton);
+    pitchLayout->addWidget(pitchProgressBar);
+
+    QGroupBox *pitchGroupBox = new QGroupBox("Pitch");
+    pitchGroupBox->setLayout(pitchLayout);
+
     // FFT widget
 
     QVBoxLayout *fftV0Layout = new QVBoxLayout;
@@ -142,10 +399,14 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
 
     fftV0Layout->addWidget(sampleRateLabel);
     fftV0Layout->addWidget(samplesPerSegmentLabel);
+    fftV0Layout->addWidget(fftSizeLabel);
     fftV0Layout->addWidget(frequenciesLabel);
     fftV0Layout->addWidget(frequencyBinsLabel);
     fftV0Layout->addWidget(segmentsLabel);
+    fftV0Layout->addWidget(spectraSizeLabel);
     fftV0Layout->addWidget(axesScaleGroupBox);
+    fftV0Layout->addWidget(prePlanCheckBox);
+    fftV0Layout->addWidget(pitchGroupBox);
 
     QVBoxLayout *fftV1Layout = new QVBoxLayout;
 
@@ -153,8 +414,25 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
 
     fftV1Layout->addWidget(segmentDurationLabel);
     fftV1Layout->addWidget(segmentDurationSpinBox);
+    fftV1Layout->addWidget(hopLabel);
+    fftV1Layout->addWidget(hopSpinBox);
+    fftV1Layout->addWidget(extraDurationsLabel);
+    fftV1Layout->addWidget(extraDurationsLineEdit);
+    fftV1Layout->addWidget(windowLabel);
+    fftV1Layout->addWidget(windowComboBox);
+    fftV1Layout->addWidget(padCheckBox);
+    fftV1Layout->addWidget(storageLabel);
+    fftV1Layout->addWidget(storageComboBox);
     fftV1Layout->addWidget(frequencyBinSizeLabel);
     fftV1Layout->addWidget(frequencyBinSizeSpinBox);
+    fftV1Layout->addWidget(scaleLabel);
+    fftV1Layout->addWidget(scaleComboBox);
+    fftV1Layout->addWidget(filterBandsLabel);
+    fftV1Layout->addWidget(filterBandsSpinBox);
+    fftV1Layout->addWidget(bandsPerOctaveLabel);
+    fftV1Layout->addWidget(bandsPerOctaveSpinBox);
+    fftV1Layout->addWidget(channelLabel);
+    fftV1Layout->addWidget(channelComboBox);
     fftV1Layout->addWidget(startFFTAnalysisButton);
     fftV1Layout->addWidget(fftProgressBar);
 
@@ -255,6 +533,16 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
     onPCAData->setChecked(false);
     onPCAData->setEnabled(false);
 
+    onPitchData = new QRadioButton("On pitch data", this);
+    onPitchData->setToolTip("Octaves above the minimum frequency and periodicity of each segment");
+    onPitchData->setChecked(false);
+    onPitchData->setEnabled(false);
+
+    onFeatureData = new QRadioButton("On spectral features", this);
+    onFeatureData->setToolTip("Centroid, spread, flux, rolloff, flatness, crest and octave band energies of each segment, computed when first used");
+    onFeatureData->setChecked(false);
+    onFeatureData->setEnabled(false);
+
     startKMeansButton = new QPushButton("Start K-Means");
     startKMeansButton->setEnabled(false);
 
@@ -270,6 +558,8 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
     kmeansLayout->addWidget(clusterNumberSpinBox);
     kmeansLayout->addWidget(onFFTData);
     kmeansLayout->addWidget(onPCAData);
+    kmeansLayout->addWidget(onPitchData);
+    kmeansLayout->addWidget(onFeatureData);
     kmeansLayout->addWidget(startKMeansButton);
     kmeansLayout->addWidget(iterationLabel);
 
@@ -404,8 +694,8 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
     waveFormGraph->axisRect()->setRangeZoom(Qt::Vertical | Qt::Horizontal);
     waveFormGraph->axisRect()->setRangeDrag(Qt::Vertical | Qt::Horizontal);
 
-    waveFormGraph->addGraph();
-    waveFormGraph->graph(0)->setName("Waveform");
+    waveForm = new WaveFormPlottable(waveFormGraph->xAxis, waveFormGraph->yAxis);
+    waveForm->setName("Waveform");
 
     waveFormGraph->legend->setVisible(true);
     waveFormGraph->legend->setBrush(QColor(255, 255, 255, 150));
@@ -425,8 +715,8 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
     waveFormFullGraph->axisRect()->setRangeZoom(Qt::Vertical | Qt::Horizontal);
     waveFormFullGraph->axisRect()->setRangeDrag(Qt::Vertical | Qt::Horizontal);
 
-    waveFormFullGraph->addGraph();
-    waveFormFullGraph->graph(0)->setName("Waveform");
+    waveFormFull = new WaveFormPlottable(waveFormFullGraph->xAxis, waveFormFullGraph->yAxis);
+    waveFormFull->setName("Waveform");
 
     waveFormFullGraph->legend->setVisible(true);
     waveFormFullGraph->legend->setBrush(QColor(255, 255, 255, 150));
@@ -482,6 +772,11 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
     spectrogramCursor->start->setCoords(0, 0);
     spectrogramCursor->end->setCoords(0, 1.0e6);
 
+    // Pitch curve, broken where segments are unvoiced
+
+    pitchGraph = spectrogramGraph->addGraph();
+    pitchGraph->setPen(QPen(Qt::cyan, 2));
+
     // PC1 vs PC2 graph
 
     pc1pc2Graph = new QCustomPlot(this);
@@ -763,7 +1058,7 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
 
     loadDataFileDialog->setAcceptMode(QFileDialog::AcceptOpen);
     loadDataFileDialog->setFileMode(QFileDialog::ExistingFile);
-    loadDataFileDialog->setNameFilter(tr("Data files (*.dat *.txt)"));
+    loadDataFileDialog->setNameFilter(tr("Data files (*.dat *.txt *.pxd)"));
 
     // Player
 
@@ -773,15 +1068,17 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
 
     clearFFTGraphs();
 
+    updateCacheSizeLabel();
+
     // Signals / Slots
 
     connect(aboutButton, &QPushButton::clicked, this, &MainWindow::about);
     connect(loadAudioFileButton, &QPushButton::clicked, [this](){ loadAudioFileDialog->open(); });
-    connect(loadAudioFileDialog, &QFileDialog::fileSelected, fourier, &Fourier::readAudioFile);
-    connect(loadAudioFileDialog, &QFileDialog::fileSelected, this, &MainWindow::loadAudio);
+    connect(loadAudioFileDialog, &QFileDialog::fileSelected, this, &MainWindow::onAudioFileSelected);
     connect(loadDataFileButton, &QPushButton::clicked, [this](){ loadDataFileDialog->open(); });
-    connect(loadDataFileDialog, &QFileDialog::fileSelected, fourier, &Fourier::readDataFile);
     connect(loadDataFileDialog, &QFileDialog::fileSelected, this, &MainWindow::onDataFileSelected);
+    connect(exportBinaryDataFileButton, &QPushButton::clicked, this, &MainWindow::exportBinaryDataFile);
+    connect(fourier, &Fourier::fileRead, this, &MainWindow::onFileRead);
     connect(fourier, &Fourier::fileRead, this, &MainWindow::enableFFTActions);
     connect(fourier, &Fourier::fileRead, this, &MainWindow::disablePCAActions);
     connect(fourier, &Fourier::fileRead, this, &MainWindow::disableKMeansActions);
@@ -794,11 +1091,25 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
     connect(fourier, &Fourier::fileRead, this, &MainWindow::clearClusterHistogram);
     connect(fourier, &Fourier::fileRead, this, &MainWindow::clearRescaledRangeGraph);
     connect(fourier, &Fourier::fileRead, this, &MainWindow::clearIntervalGraphs);
+    connect(fourier, &Fourier::fileDecodingFailed, this, &MainWindow::clearWaveFormGraphs);
+    connect(fourier, &Fourier::fileDecodingFailed, this, &MainWindow::onLoadFailed);
     connect(fourier, &Fourier::fileDecodingFailed, this, &MainWindow::showFileDecodingFailedDialog);
-    connect(startFFTAnalysisButton, &QPushButton::clicked, this, &MainWindow::updateFFTProgressBarMaximum);
+    connect(keepChannelsCheckBox, &QCheckBox::stateChanged, [this](int state){ fourier->keepChannels = (state == Qt::Checked); });
+    connect(analysisSampleRateComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), [this](int index){ fourier->analysisSampleRate = analysisSampleRateComboBox->itemData(index).toInt(); });
+    connect(regionStartSpinBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), [this](double value){ fourier->regionStart = value; });
+    connect(regionEndSpinBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), [this](double value){ fourier->regionEnd = value; });
+    connect(useCacheCheckBox, &QCheckBox::stateChanged, [this](int state){ fourier->useCache = (state == Qt::Checked); });
+    connect(cacheLimitSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int value){ fourier->cacheMaxBytes = static_cast<qint64>(value) << 20; });
+    connect(clearCacheButton, &QPushButton::clicked, this, &MainWindow::clearCache);
+    connect(fourier, &Fourier::fileRead, this, &MainWindow::updateCacheSizeLabel);
+    connect(fourier, &Fourier::fileRead, this, &MainWindow::prePlanFFTs);
+    connect(prePlanCheckBox, &QCheckBox::stateChanged, [this](int state){ if (state == Qt::Checked) prePlanFFTs(); else planner->cancel(); });
+    connect(channelComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::selectChannel);
+    connect(startFFTAnalysisButton, &QPushButton::clicked, [this](){ resetProgressBar(fftProgressBar); });
+    connect(startFFTAnalysisButton, &QPushButton::clicked, [this](){ channelComboBox->setEnabled(false); trackPitchButton->setEnabled(false); });
+    connect(startFFTAnalysisButton, &QPushButton::clicked, planner, &FFTPlanner::cancel);
     connect(startFFTAnalysisButton, &QPushButton::clicked, fourier, &Fourier::performFFTAnalysis);
     connect(fourier, &Fourier::sendMessage, [this](QString message){ startFFTAnalysisButton->setText(message); });
-    connect(fourier, &Fourier::fftAnalysisStep, fftProgressBar, &QProgressBar::setValue);
     connect(fourier, &Fourier::fftAnalysisPerformed, this, &MainWindow::onFFTPerformed);
     connect(fourier, &Fourier::fftAnalysisPerformed, this, &MainWindow::deleteClusterButtons);
     connect(fourier, &Fourier::fftAnalysisPerformed, this, &MainWindow::setSpectrogram);
@@ -807,10 +1118,19 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
     connect(fourier, &Fourier::fftAnalysisPerformed, this, &MainWindow::clearRescaledRangeGraph);
     connect(fourier, &Fourier::fftAnalysisPerformed, this, &MainWindow::clearIntervalGraphs);
     connect(fourier, &Fourier::fftAnalysisPerformed, this, &MainWindow::disableHurstActions);
+    connect(fourier, &Fourier::fftAnalysisPerformed, this, &MainWindow::clearPitchGraph);
+    connect(fourier, &Fourier::fftAnalysisPerformed, [this](){ spectralFeatures->clearFeaturesData(); });
+    connect(spectralFeatures, &SpectralFeatures::featuresPerformed, [this](){ kmeans->initData(spectralFeatures->features); kmeans->performKMeans(); });
+    connect(minPitchSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int value){ pitch->minFrequency = value; });
+    connect(maxPitchSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int value){ pitch->maxFrequency = value; });
+    connect(trackPitchButton, &QPushButton::clicked, this, &MainWindow::performPitchTracking);
+    connect(pitch, &Pitch::pitchPerformed, this, &MainWindow::onPitchPerformed);
+    connect(pitch, &QThread::finished, this, &MainWindow::updateFileActions);
+    connect(pca, &QThread::finished, this, &MainWindow::updateFileActions);
+    connect(kmeans, &QThread::finished, this, &MainWindow::updateFileActions);
+    connect(spectralFeatures, &QThread::finished, this, &MainWindow::updateFileActions);
     connect(startPCAButton, &QPushButton::clicked, this, &MainWindow::onPCAStarted);
     connect(startPCAButton, &QPushButton::clicked, this, &MainWindow::performPCA);
-    connect(pca, &PCA::pcaIterationStep, [this](int step){ pcaIterationLabel->setText(QString("Iteration: %1").arg(step)); });
-    connect(pca, &PCA::pcaStep, pcaProgressBar, &QProgressBar::setValue);
     connect(pca, &PCA::pcaPerformed, this, &MainWindow::onPCAPerformed);
     connect(pca, &PCA::pcaPerformed, this, &MainWindow::setPCAGraphs);
     connect(pca, &PCA::pcaAborted, this, &MainWindow::onPCAAborted);
@@ -818,7 +1138,6 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
     connect(componentNumberSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &MainWindow::updateComponentNumber);
     connect(startKMeansButton, &QPushButton::clicked, this, &MainWindow::onKMeansStarted);
     connect(startKMeansButton, &QPushButton::clicked, this, &MainWindow::performKMeans);
-    connect(kmeans, &KMeans::kMeansIterationStep, [this](int step){ iterationLabel->setText(QString("Iteration: %1").arg(step)); });
     connect(kmeans, &KMeans::kMeansPerformed, this, &MainWindow::onKMeansPerformed);
     connect(kmeans, &KMeans::kMeansPerformed, this, &MainWindow::createClusterButtons);
     connect(kmeans, &KMeans::kMeansPerformed, this, &MainWindow::setPCAClusteredGraphs);
@@ -837,9 +1156,26 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
     connect(hurst, &Hurst::notEnoughData, this, &MainWindow::setIntervalGraph);
     connect(hurst, &Hurst::notEnoughData, this, &MainWindow::setCumulativeIntervalGraph);
     connect(segmentDurationSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &MainWindow::updateSegmentDuration);
+    connect(extraDurationsLineEdit, &QLineEdit::editingFinished, this, &MainWindow::updateExtraDurations);
+    connect(storageComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), [this](){ fourier->storageFormat = static_cast<CompactMatrix::Format>(storageComboBox->currentData().toInt()); });
+    connect(hopSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &MainWindow::updateHop);
+    connect(windowComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), [this](int index){ fourier->window = static_cast<Fourier::Window>(windowComboBox->itemData(index).toInt()); });
+    connect(padCheckBox, &QCheckBox::stateChanged, [this](int state){ fourier->padToSmoothSize = (state == Qt::Checked); if (fourier->sampleRate > 0) updateSegmentDuration(fourier->milliseconds); prePlanFFTs(); });
     connect(frequencyBinSizeSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &MainWindow::updateFrequencyBinSize);
+    connect(scaleComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::updateScale);
+    connect(filterBandsSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &MainWindow::updateScale);
+    connect(bandsPerOctaveSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &MainWindow::updateScale);
     connect(clusterNumberSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &MainWindow::updateClusterNumber);
     connect(playPauseButton, &QPushButton::clicked, this, &MainWindow::togglePlayback);
+    connect(liveInputButton, &QPushButton::toggled, this, &MainWindow::toggleLiveInput);
+    connect(liveTimer, &QTimer::timeout, this, &MainWindow::updateLiveGraphs);
+    connect(progressTimer, &QTimer::timeout, this, &MainWindow::updateProgress);
+
+    for (QThread *thread : std::initializer_list<QThread*>{ fourier, pitch, spectralFeatures, pca, kmeans })
+    {
+        connect(thread, &QThread::started, this, [this, thread](){ progressThreads.push_back(thread); progressTimer->start(); });
+    }
+    connect(liveAnalyzer, &LiveAnalyzer::captureFailed, this, &MainWindow::showCaptureFailedDialog);
     connect(player, &QMediaPlayer::positionChanged, this, &MainWindow::updatePositionLabel);
     connect(player, &QMediaPlayer::positionChanged, this, &MainWindow::selectCurrentSegment);
     connect(player, &QMediaPlayer::positionChanged, this, &MainWindow::shiftWaveFormFullCursor);
@@ -852,14 +1188,14 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
     connect(xAxisScaleCheckBox, &QCheckBox::stateChanged, this, &MainWindow::toggleXAxisScale);
     connect(yAxisScaleCheckBox, &QCheckBox::stateChanged, this, &MainWindow::toggleYAxisScale);
     connect(hullsToggleCheckBox, &QCheckBox::stateChanged, [this](int state){ Q_UNUSED(state) setPCAClusteredGraphs(); });
-    connect(waveFormGraph->xAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (waveFormGraph->graph(0)->dataCount() > 0) waveFormGraph->xAxis->setRange(newRange.bounded(fourier->minTime, fourier->maxTime)); });
-    connect(waveFormGraph->yAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (waveFormGraph->graph(0)->dataCount() > 0) waveFormGraph->yAxis->setRange(newRange.bounded(fourier->minWaveForm, fourier->maxWaveForm)); });
-    connect(waveFormFullGraph->xAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (waveFormFullGraph->graph(0)->dataCount() > 0) waveFormFullGraph->xAxis->setRange(newRange.bounded(fourier->minTime, fourier->maxTime)); });
-    connect(waveFormFullGraph->yAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (waveFormFullGraph->graph(0)->dataCount() > 0) waveFormFullGraph->yAxis->setRange(newRange.bounded(fourier->minWaveForm, fourier->maxWaveForm)); });
-    connect(spectrumGraph->xAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (!fourier->frequencies.empty()) spectrumGraph->xAxis->setRange(newRange.bounded(fourier->frequencies.first(), fourier->frequencies.last())); });
-    connect(spectrumGraph->yAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (!fourier->spectra.empty()) spectrumGraph->yAxis->setRange(newRange.bounded(0, fourier->supPower)); });
-    connect(spectrogramGraph->xAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (!fourier->frequencies.empty()) spectrogramGraph->xAxis->setRange(newRange.bounded(fourier->minTime, fourier->maxTime)); });
-    connect(spectrogramGraph->yAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (!fourier->frequencies.empty()) spectrogramGraph->yAxis->setRange(newRange.bounded(fourier->frequencies.first(), fourier->frequencies.last())); });
+    connect(waveFormGraph->xAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (waveForm->dataCount() > 0) waveFormGraph->xAxis->setRange(newRange.bounded(fourier->minTime, fourier->maxTime)); });
+    connect(waveFormGraph->yAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (waveForm->dataCount() > 0) waveFormGraph->yAxis->setRange(newRange.bounded(fourier->minWaveForm, fourier->maxWaveForm)); });
+    connect(waveFormFullGraph->xAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (waveFormFull->dataCount() > 0) waveFormFullGraph->xAxis->setRange(newRange.bounded(fourier->minTime, fourier->maxTime)); });
+    connect(waveFormFullGraph->yAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (waveFormFull->dataCount() > 0) waveFormFullGraph->yAxis->setRange(newRange.bounded(fourier->minWaveForm, fourier->maxWaveForm)); });
+    connect(spectrumGraph->xAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (!liveAnalyzer->isCapturing() && !fourier->frequencies.empty()) spectrumGraph->xAxis->setRange(newRange.bounded(fourier->frequencies.first(), fourier->frequencies.last())); });
+    connect(spectrumGraph->yAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (!liveAnalyzer->isCapturing() && !fourier->spectra.isEmpty()) spectrumGraph->yAxis->setRange(newRange.bounded(0, fourier->supPower)); });
+    connect(spectrogramGraph->xAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (!liveAnalyzer->isCapturing() && !fourier->frequencies.empty()) spectrogramGraph->xAxis->setRange(newRange.bounded(fourier->minTime, fourier->maxTime)); });
+    connect(spectrogramGraph->yAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (!fourier->frequencies.empty()) spectrogramGraph->yAxis->setRange(newRange.bounded(spectrogram->data()->valueRange().lower, spectrogram->data()->valueRange().upper)); });
     connect(clusterLengthHistogramGraph->yAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (!kmeans->clusterLengthHistogram.empty()) clusterLengthHistogramGraph->yAxis->setRange(newRange.bounded(0, kmeans->clusterLengthHistogramMax * 1.1)); });
     connect(intervalGraph->xAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (!hurst->series.empty()) intervalGraph->xAxis->setRange(newRange.bounded(0, hurst->series.size() - 1)); });
     connect(intervalGraph->yAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), [this](const QCPRange &newRange){ if (!hurst->series.empty()) intervalGraph->yAxis->setRange(newRange.bounded(0, hurst->maxSeries)); });
@@ -869,10 +1205,14 @@ MainWindow::MainWindow(QWidget *parent): QWidget(parent)
 
 MainWindow::~MainWindow()
 {
+    delete liveAnalyzer;
+    delete pitch;
+    delete spectralFeatures;
     delete fourier;
     delete pca;
     delete kmeans;
     delete hurst;
+    delete planner;
 }
 
 void MainWindow::about()
@@ -908,7 +1248,20 @@ void MainWindow::showFileDecodingFailedDialog()
 
     errorBox->setWindowTitle("Error");
 
-    errorBox->setText("Failed to decode audio file.");
+    errorBox->setText("Failed to decode file.");
+
+    setWindowTitle("Pitch Explorer");
+
+    errorBox->exec();
+}
+
+void MainWindow::showCaptureFailedDialog(QString message)
+{
+    QMessageBox *errorBox = new QMessageBox(this);
+
+    errorBox->setWindowTitle("Error");
+
+    errorBox->setText(message);
 
     errorBox->exec();
 }
@@ -919,6 +1272,10 @@ void MainWindow::disableKMeansActions()
     clusterNumberSpinBox->setEnabled(false);
     onPCAData->setChecked(false);
     onPCAData->setEnabled(false);
+    onPitchData->setChecked(false);
+    onPitchData->setEnabled(false);
+    onFeatureData->setChecked(false);
+    onFeatureData->setEnabled(false);
     onFFTData->setChecked(true);
     iterationLabel->setText("Iteration: 0");
 }
@@ -927,7 +1284,7 @@ void MainWindow::disablePCAActions()
 {
     startPCAButton->setEnabled(false);
     componentNumberSpinBox->setEnabled(false);
-    pcaProgressBar->setValue(0);
+    resetProgressBar(pcaProgressBar);
     pcaIterationLabel->setText("Iteration: 0");
 }
 
@@ -945,8 +1302,10 @@ void MainWindow::enableHurstActions()
 
 void MainWindow::enableFFTActions()
 {
+    exportBinaryDataFileButton->setEnabled(true);
     startFFTAnalysisButton->setEnabled(true);
     segmentDurationSpinBox->setEnabled(true);
+    hopSpinBox->setEnabled(true);
     frequencyBinSizeSpinBox->setEnabled(true);
 
     sampleRateLabel->setText(QString("Sample rate: %1Hz").arg(fourier->sampleRate));
@@ -962,17 +1321,37 @@ void MainWindow::enableFFTActions()
     }
 
     int nSegments = computeSegmentNumber();
-    int nFrequencies = nSamplesPerSegment / 2 + 1;
+    int nFrequencies = fourier->fftSize(nSamplesPerSegment) / 2 + 1;
     int nFrequencyBins = static_cast<int>(ceil(static_cast<double>(nFrequencies - 1) / fourier->frequencyBinSize));
 
     samplesPerSegmentLabel->setText(QString("Samples/segment: %1").arg(nSamplesPerSegment));
+    setFFTSizeLabel(nSamplesPerSegment);
     segmentsLabel->setText(QString("Segments: %1").arg(nSegments));
     frequenciesLabel->setText(QString("Frequencies: %1").arg(nFrequencies));
     frequencyBinsLabel->setText(QString("Frequency bins: %1").arg(nFrequencyBins));
 
     frequencyBinSizeSpinBox->setMaximum(nFrequencyBins);
 
-    fftProgressBar->setValue(0);
+    // Channel selector, first entry concatenates all channels
+
+    channelComboBox->blockSignals(true);
+    channelComboBox->clear();
+
+    if (fourier->channels > 1)
+    {
+        channelComboBox->addItem("All");
+    }
+
+    for (int c = 0; c < fourier->channels; c++)
+    {
+        channelComboBox->addItem(QString("%1").arg(c + 1));
+    }
+
+    channelComboBox->setCurrentIndex(0);
+    channelComboBox->setEnabled(fourier->channels > 1);
+    channelComboBox->blockSignals(false);
+
+    resetProgressBar(fftProgressBar);
 }
 
 void MainWindow::onFFTPerformed()
@@ -981,18 +1360,29 @@ void MainWindow::onFFTPerformed()
     clusterNumberSpinBox->setEnabled(true);
     onPCAData->setChecked(false);
     onPCAData->setEnabled(false);
+    onPitchData->setChecked(false);
+    onPitchData->setEnabled(!pitch->isRunning() && !pitch->features.isEmpty());
+    onFeatureData->setChecked(false);
+    onFeatureData->setEnabled(!fourier->channelMagnitudes(fourier->displayedChannel()).isEmpty());
     onFFTData->setChecked(true);
 
     startPCAButton->setEnabled(true);
     componentNumberSpinBox->setEnabled(true);
-    componentNumberSpinBox->setMaximum(fourier->frequencies.size());
-    pcaProgressBar->setValue(0);
+    componentNumberSpinBox->setMaximum(fourier->spectra.isEmpty() ? fourier->frequencies.size() : fourier->spectra.columns());
+    resetProgressBar(pcaProgressBar);
+
+    channelComboBox->setEnabled(fourier->channels > 1);
+
+    trackPitchButton->setEnabled(!pitch->isRunning());
 
     startFFTAnalysisButton->setText("Start FFT analysis");
 
     milliseconds = fourier->milliseconds;
+    hopMilliseconds = fourier->hopMilliseconds;
 
-    player->setNotifyInterval(fourier->milliseconds);
+    spectraSizeLabel->setText(QString("Spectra: %1 MB").arg(fourier->spectraBytes() >> 20));
+
+    player->setNotifyInterval(hopMilliseconds);
 
     spectrumGraph->xAxis->setRange(fourier->frequencies.first(), fourier->frequencies.last());
     spectrumGraph->yAxis->setRange(0, fourier->supPower);
@@ -1019,10 +1409,10 @@ void MainWindow::onPCAStarted()
     loadAudioFileButton->setEnabled(false);
     loadDataFileButton->setEnabled(false);
     startFFTAnalysisButton->setEnabled(false);
+    channelComboBox->setEnabled(false);
     componentNumberSpinBox->setEnabled(false);
 
-    pcaProgressBar->setMaximum(pca->componentNumber);
-    pcaProgressBar->setValue(0);
+    resetProgressBar(pcaProgressBar);
     pcaIterationLabel->setText("Iteration: 0");
 }
 
@@ -1035,9 +1425,6 @@ void MainWindow::onPCAPerformed()
 
     onPCAData->setEnabled(true);
 
-    loadAudioFileButton->setEnabled(true);
-    loadDataFileButton->setEnabled(true);
-    startFFTAnalysisButton->setEnabled(true);
     componentNumberSpinBox->setEnabled(true);
 }
 
@@ -1048,18 +1435,48 @@ void MainWindow::onPCAAborted()
 
     abortPCAButton->setEnabled(false);
 
-    loadAudioFileButton->setEnabled(true);
-    loadDataFileButton->setEnabled(true);
-    startFFTAnalysisButton->setEnabled(true);
     componentNumberSpinBox->setEnabled(true);
 }
 
+void MainWindow::updateFileActions()
+{
+    // Loading, analysing again or switching channel frees the samples and spectra that pitch tracking, PCA,
+    // K-Means and the spectral features read: allowed only once all have finished, as each thread's finished signal tells
+    // Analysing or switching channel during a load would read the previous file's samples, live input is held back too
+
+    bool idle = !pitch->isRunning() && !pca->isRunning() && !kmeans->isRunning() && !spectralFeatures->isRunning() && !liveAnalyzer->isCapturing();
+    bool analysable = idle && !loadPending && samplesShown && fourier->sampleNumber > 0;
+
+    loadAudioFileButton->setEnabled(idle);
+    loadDataFileButton->setEnabled(idle);
+    startFFTAnalysisButton->setEnabled(analysable);
+    channelComboBox->setEnabled(analysable && !fourier->isRunning() && fourier->channels > 1);
+    liveInputButton->setEnabled(!loadPending);
+}
+
 void MainWindow::performKMeans()
 {
     if (onPCAData->isChecked())
     {
         kmeans->initData(pca->principalComponents);
     }
+    else if (onPitchData->isChecked())
+    {
+        kmeans->initData(pitch->features);
+    }
+    else if (onFeatureData->isChecked())
+    {
+        // Computed from the displayed channel's magnitudes on first use, K-Means follows
+
+        if (spectralFeatures->features.isEmpty())
+        {
+            spectralFeatures->initData(fourier->channelMagnitudes(fourier->displayedChannel()), fourier->frequencyStep());
+            spectralFeatures->computeFeatures();
+            return;
+        }
+
+        kmeans->initData(spectralFeatures->features);
+    }
     else
     {
         kmeans->initData(fourier->spectra);
@@ -1076,6 +1493,7 @@ void MainWindow::onKMeansStarted()
     loadAudioFileButton->setEnabled(false);
     loadDataFileButton->setEnabled(false);
     startFFTAnalysisButton->setEnabled(false);
+    channelComboBox->setEnabled(false);
     clusterNumberSpinBox->setEnabled(false);
 }
 
@@ -1084,9 +1502,6 @@ void MainWindow::onKMeansPerformed()
     startKMeansButton->setText("Start K-Means");
     startKMeansButton->setEnabled(true);
 
-    loadAudioFileButton->setEnabled(true);
-    loadDataFileButton->setEnabled(true);
-    startFFTAnalysisButton->setEnabled(true);
     clusterNumberSpinBox->setEnabled(true);
 }
 
@@ -1131,14 +1546,36 @@ void MainWindow::updateComponentNumber(int value)
 
 void MainWindow::updateSegmentDuration(int value)
 {
+    // A hop equal to the segment duration follows it: segments stay back to back
+
+    bool backToBack = fourier->hopMilliseconds == fourier->milliseconds;
+
     fourier->milliseconds = value;
 
+    if (backToBack)
+    {
+        hopSpinBox->setValue(value);
+    }
+
+    // A duration computed along with the displayed one swaps its spectra in, with the hop they were computed with
+    // Pitch and spectral features belong to the previous segmentation
+
+    if (!fourier->isRunning() && !pca->isRunning() && !kmeans->isRunning() && !pitch->isRunning() && !spectralFeatures->isRunning() && !liveAnalyzer->isCapturing() && fourier->selectResolution(value))
+    {
+        hopSpinBox->setValue(fourier->hopMilliseconds);
+
+        clearPitchGraph();
+        spectralFeatures->clearFeaturesData();
+        onSpectraChanged();
+    }
+
     int nSamplesPerSegment = fourier->sampleRate * fourier->milliseconds / 1000;
     int nSegments = computeSegmentNumber();
-    int nFrequencies = nSamplesPerSegment / 2 + 1;
+    int nFrequencies = fourier->fftSize(nSamplesPerSegment) / 2 + 1;
     int nFrequencyBins = static_cast<int>(ceil(static_cast<double>(nFrequencies - 1) / fourier->frequencyBinSize));
 
     samplesPerSegmentLabel->setText(QString("Samples/segment: %1").arg(nSamplesPerSegment));
+    setFFTSizeLabel(nSamplesPerSegment);
     segmentsLabel->setText(QString("Segments: %1").arg(nSegments));
     frequenciesLabel->setText(QString("Frequencies: %1").arg(nFrequencies));
     frequencyBinsLabel->setText(QString("Frequency bins: %1").arg(nFrequencyBins));
@@ -1146,41 +1583,182 @@ void MainWindow::updateSegmentDuration(int value)
     frequencyBinSizeSpinBox->setMaximum(nFrequencyBins);
 }
 
+void MainWindow::updateHop(int value)
+{
+    fourier->hopMilliseconds = value;
+
+    segmentsLabel->setText(QString("Segments: %1").arg(computeSegmentNumber()));
+}
+
+void MainWindow::updateExtraDurations()
+{
+    // Durations separated by commas or spaces, anything else is dropped
+
+    QVector<int> durations;
+
+    for (const QString &item : extraDurationsLineEdit->text().split(QRegExp("[,\\s]+"), QString::SkipEmptyParts))
+    {
+        bool ok = false;
+        int duration = item.toInt(&ok);
+
+        if (ok && duration >= segmentDurationSpinBox->minimum() && duration <= segmentDurationSpinBox->maximum() && !durations.contains(duration))
+        {
+            durations.push_back(duration);
+        }
+    }
+
+    fourier->extraDurations = durations;
+
+    QStringList items;
+
+    for (int duration : durations)
+    {
+        items.push_back(QString::number(duration));
+    }
+
+    extraDurationsLineEdit->setText(items.join(", "));
+}
+
 void MainWindow::updateFrequencyBinSize(int value)
 {
     fourier->frequencyBinSize = value;
 
     int nSamplesPerSegment = fourier->sampleRate * fourier->milliseconds / 1000;
-    int nFrequencies = nSamplesPerSegment / 2 + 1;
+    int nFrequencies = fourier->fftSize(nSamplesPerSegment) / 2 + 1;
     int nFrequencyBins = static_cast<int>(ceil(static_cast<double>(nFrequencies - 1) / fourier->frequencyBinSize));
 
     frequencyBinsLabel->setText(QString("Frequency bins: %1").arg(nFrequencyBins));
     frequencyBinSizeSpinBox->setMaximum(nFrequencyBins);
+
+    if (fourier->scale == FilterBank::Linear)
+    {
+        rebinSpectra();
+    }
 }
 
-void MainWindow::updateFFTProgressBarMaximum()
+void MainWindow::updateScale()
 {
-    int nSegments = computeSegmentNumber();
+    fourier->scale = static_cast<FilterBank::Scale>(scaleComboBox->currentData().toInt());
+    fourier->filterBands = filterBandsSpinBox->value();
+    fourier->bandsPerOctave = bandsPerOctaveSpinBox->value();
 
-    fftProgressBar->setMaximum(2 * nSegments);
-    fftProgressBar->setValue(0);
+    filterBandsSpinBox->setEnabled(fourier->scale == FilterBank::Mel || fourier->scale == FilterBank::Bark);
+    bandsPerOctaveSpinBox->setEnabled(fourier->scale == FilterBank::Logarithmic || fourier->scale == FilterBank::ConstantQ);
+    windowComboBox->setEnabled(fourier->scale != FilterBank::ConstantQ);
+
+    rebinSpectra();
 }
 
-int MainWindow::computeSegmentNumber()
+void MainWindow::rebinSpectra()
+{
+    // The last analysis is reduced again in place, unless it is still running or being analysed further
+    // Constant-Q bands need a new analysis, as does a constant-Q analysis or one framed with another window
+
+    if (fourier->canRebinSpectra() && !fourier->isRunning() && !pca->isRunning() && !kmeans->isRunning() && !spectralFeatures->isRunning() && !pitch->isRunning() && !liveAnalyzer->isCapturing())
+    {
+        fourier->rebinSpectra();
+        onSpectraChanged();
+    }
+}
+
+void MainWindow::selectChannel(int index)
 {
-    unsigned int nSamplesPerSegment = static_cast<unsigned int>(fourier->sampleRate * fourier->milliseconds / 1000);
+    // With several channels the first entry is the concatenation of all of them
+
+    fourier->selectSpectraChannel(fourier->channels > 1 ? index - 1 : index);
 
-    int nSegments = 0;
+    // Pitch and spectral features were obtained from the previously displayed channel
 
-    for (unsigned int i = 0; i < fourier->sampleNumber; i += nSamplesPerSegment)
+    clearPitchGraph();
+    spectralFeatures->clearFeaturesData();
+
+    setWaveFormGraph();
+    setWaveFormFullGraph();
+
+    if (!fourier->spectra.isEmpty())
     {
-        if (i + nSamplesPerSegment < fourier->sampleNumber)
-        {
-            nSegments++;
-        }
+        onSpectraChanged();
     }
+}
+
+void MainWindow::onSpectraChanged()
+{
+    // PCA and K-Means results belong to the previous spectra
 
-    return nSegments;
+    onFFTPerformed();
+    deleteClusterButtons();
+    setSpectrogram();
+    clearPCAGraphs();
+    clearClusterHistogram();
+    clearRescaledRangeGraph();
+    clearIntervalGraphs();
+    disableHurstActions();
+
+    replotSpectrumGraph(player->position());
+}
+
+int MainWindow::segmentIndex(qint64 position)
+{
+    // Segments are counted from the start of the region of interest, negative before it
+    // With overlapping segments the current one is that whose center is nearest, as drawn in the spectrogram
+
+    qint64 offset = position - segmentPosition(0);
+
+    if (offset < 0)
+    {
+        return -1;
+    }
+
+    return std::max(0, static_cast<int>(floor((offset / 1000.0 - segmentSeconds() / 2) / hopSeconds() + 0.5)));
+}
+
+qint64 MainWindow::segmentPosition(int index)
+{
+    // Start of the segment
+
+    return static_cast<qint64>(1000 * fourier->minTime) + qRound64(1000 * index * hopSeconds());
+}
+
+double MainWindow::segmentSeconds() const
+{
+    // Segments are cut in whole samples: their duration and hop differ slightly from those set in milliseconds
+
+    if (fourier->sampleRate <= 0)
+    {
+        return milliseconds / 1000.0;
+    }
+
+    return static_cast<double>(fourier->sampleRate * milliseconds / 1000) / fourier->sampleRate;
+}
+
+double MainWindow::hopSeconds() const
+{
+    if (fourier->sampleRate <= 0)
+    {
+        return hopMilliseconds / 1000.0;
+    }
+
+    return static_cast<double>(std::max(1, fourier->sampleRate * hopMilliseconds / 1000)) / fourier->sampleRate;
+}
+
+int MainWindow::regionEndPosition()
+{
+    return static_cast<int>(segmentPosition(0)) + fourier->duration;
+}
+
+void MainWindow::setFFTSizeLabel(int nSamplesPerSegment)
+{
+    int nFFT = fourier->fftSize(nSamplesPerSegment);
+
+    fftSizeLabel->setText(QString("FFT size: %1 (cost %2)").arg(nFFT).arg(FFTPlanner::relativeCost(nFFT), 0, 'f', 2));
+}
+
+int MainWindow::computeSegmentNumber()
+{
+    int nSamplesPerSegment = fourier->sampleRate * fourier->milliseconds / 1000;
+    int nHop = std::max(1, fourier->sampleRate * fourier->hopMilliseconds / 1000);
+
+    return FFTPlanner::segmentNumber(static_cast<int>(fourier->sampleNumber), nSamplesPerSegment, nHop);
 }
 
 void MainWindow::updateClusterNumber(int value)
@@ -1230,6 +1808,88 @@ void MainWindow::createClusterButtons()
     currentClusterButton = nullptr;
 }
 
+void MainWindow::onAudioFileSelected(const QString path)
+{
+    onLoadStarted(path);
+
+    filePath = path;
+    audioFileSelected = true;
+
+    fourier->readAudioFile(path);
+}
+
+void MainWindow::onDataFileSelected(const QString path)
+{
+    onLoadStarted(path);
+
+    filePath = path;
+    audioFileSelected = false;
+
+    fourier->readDataFile(path);
+}
+
+void MainWindow::onLoadStarted(const QString path)
+{
+    // Loading runs on the Fourier thread: detach everything that reads the current samples
+    // Selecting another file while loading cancels the load in progress
+
+    currentClusterButton = nullptr;
+
+    player->stop();
+    playPauseButton->setEnabled(false);
+
+    clearWaveFormGraphs();
+
+    exportBinaryDataFileButton->setEnabled(false);
+    segmentDurationSpinBox->setEnabled(false);
+    hopSpinBox->setEnabled(false);
+    frequencyBinSizeSpinBox->setEnabled(false);
+    channelComboBox->setEnabled(false);
+
+    startFFTAnalysisButton->setText("Start FFT analysis");
+
+    disablePCAActions();
+    disableKMeansActions();
+    disableHurstActions();
+
+    trackPitchButton->setEnabled(false);
+
+    resetProgressBar(fftProgressBar);
+
+    setWindowTitle(QString("Pitch Explorer - Loading %1").arg(path));
+
+    loadPending = true;
+    samplesShown = false;
+
+    updateFileActions();
+}
+
+void MainWindow::onLoadFailed()
+{
+    // The previous file's samples are still held, but no longer shown: nothing to analyse until the next load
+
+    loadPending = false;
+
+    updateFileActions();
+}
+
+void MainWindow::onFileRead()
+{
+    loadPending = false;
+    samplesShown = true;
+
+    updateFileActions();
+
+    if (audioFileSelected)
+    {
+        loadAudio(filePath);
+    }
+    else
+    {
+        loadData(filePath);
+    }
+}
+
 void MainWindow::loadAudio(const QString path)
 {
     currentClusterButton = nullptr;
@@ -1237,11 +1897,15 @@ void MainWindow::loadAudio(const QString path)
     player->stop();
     player->setMedia(QUrl::fromLocalFile(path));
 
-    player->setNotifyInterval(fourier->milliseconds);
+    player->setNotifyInterval(fourier->hopMilliseconds);
 
     playPauseButton->setEnabled(true);
 
-    positionLabel->setText(QString("00:00:00 / %1").arg(msToTime(fourier->duration)));
+    // Playback starts at the region of interest
+
+    player->setPosition(segmentPosition(0));
+
+    positionLabel->setText(QString("%1 / %2").arg(msToTime(static_cast<int>(segmentPosition(0)))).arg(msToTime(regionEndPosition())));
 
     setWindowTitle(QString("Pitch Explorer - %1").arg(path));
 }
@@ -1263,7 +1927,7 @@ void MainWindow::togglePlayback(bool checked)
 void MainWindow::updatePositionLabel(qint64 position)
 {
     int pos = static_cast<int>(position);
-    positionLabel->setText(QString("%1 / %2").arg(msToTime(pos)).arg(msToTime(fourier->duration)));
+    positionLabel->setText(QString("%1 / %2").arg(msToTime(pos)).arg(msToTime(regionEndPosition())));
 }
 
 void MainWindow::selectCurrentSegment(qint64 position)
@@ -1275,9 +1939,9 @@ void MainWindow::selectCurrentSegment(qint64 position)
 
     if (!clusterButtons.empty())
     {
-        int i = static_cast<int>(position / milliseconds);
+        int i = segmentIndex(position);
 
-        if (i < clusterButtons.size())
+        if (i >= 0 && i < clusterButtons.size())
         {
             clusterButtons[i]->setStyleSheet(QString("background-color: hsl(%1, 255, 180); border: 1px solid black; padding-top: 2px;").arg(320 * kmeans->clusterIndexes[i] / clusterNumber));
             currentClusterButton = clusterButtons[i];
@@ -1288,8 +1952,7 @@ void MainWindow::selectCurrentSegment(qint64 position)
 
 void MainWindow::changePlaybackPosition(int index)
 {
-    qint64 position = static_cast<qint64>(index * milliseconds);
-    player->setPosition(position);
+    player->setPosition(segmentPosition(index));
 
     if (player->state() == QMediaPlayer::StoppedState || player->state() == QMediaPlayer::PausedState)
     {
@@ -1303,13 +1966,19 @@ void MainWindow::changePlaybackPosition(int index)
 
 void MainWindow::replotSpectrumGraph(qint64 position)
 {
-    if (!fourier->spectra.empty())
+    if (!fourier->spectra.isEmpty())
     {
-        int index = static_cast<int>(position / milliseconds);
+        int index = segmentIndex(position);
 
-        if (index < fourier->spectra.size())
+        if (index >= 0 && index < fourier->spectra.rows())
         {
-            spectrumGraph->graph(0)->setData(fourier->frequencies, fourier->spectra[index], true);
+            // Concatenated channels: plot the first one
+
+            std::vector<Real> buffer(static_cast<size_t>(fourier->spectra.columns()));
+            const Real *row = fourier->spectra.row(index, buffer.data());
+
+            QVector<double> power(row, row + fourier->frequencies.size());
+            spectrumGraph->graph(0)->setData(fourier->frequencies, power, true);
             spectrumGraph->replot();
         }
     }
@@ -1324,6 +1993,253 @@ void MainWindow::onPlayerStateChanged(QMediaPlayer::State state)
     }
 }
 
+void MainWindow::toggleLiveInput(bool checked)
+{
+    if (checked)
+    {
+        // Live input takes over the spectrum graph and spectrogram, with the current FFT settings
+        // Whatever else would draw on them meanwhile is disabled
+
+        player->stop();
+
+        liveAnalyzer->milliseconds = fourier->milliseconds;
+        liveAnalyzer->hopMilliseconds = fourier->hopMilliseconds;
+        liveAnalyzer->window = fourier->window;
+        liveAnalyzer->kaiserBeta = fourier->kaiserBeta;
+        liveAnalyzer->frequencyBinSize = fourier->frequencyBinSize;
+        liveAnalyzer->padToSmoothSize = fourier->padToSmoothSize;
+        liveAnalyzer->scale = fourier->scale;
+        liveAnalyzer->filterBands = fourier->filterBands;
+        liveAnalyzer->bandsPerOctave = fourier->bandsPerOctave;
+
+        if (!liveAnalyzer->startCapture())
+        {
+            liveInputButton->blockSignals(true);
+            liveInputButton->setChecked(false);
+            liveInputButton->blockSignals(false);
+            return;
+        }
+
+        liveDisabledWidgets.clear();
+
+        for (QWidget *widget : std::initializer_list<QWidget*>{ loadAudioFileButton, loadDataFileButton, startFFTAnalysisButton, playPauseButton, channelComboBox, trackPitchButton })
+        {
+            if (widget->isEnabled())
+            {
+                widget->setEnabled(false);
+                liveDisabledWidgets.push_back(widget);
+            }
+        }
+
+        liveSupPower = 0;
+
+        itemTracer->setVisible(false);
+
+        pitchGraph->data()->clear();
+
+        // Ten seconds of columns, scrolled as rows arrive, with the rows of the scale actually analysed
+
+        double hop = liveAnalyzer->hopSeconds();
+        int nHistory = std::max(1, qRound(10.0 / hop));
+
+        QCPRange valueRange = setFrequencyAxis(liveAnalyzer->spectraScale(), liveAnalyzer->frequencies);
+
+        liveSpectrogramData = new QCPColorMapData(nHistory, liveAnalyzer->frequencies.size(), QCPRange(-(nHistory - 1) * hop, 0), valueRange);
+        spectrogram->setData(liveSpectrogramData);
+
+        spectrumGraph->xAxis->setRange(liveAnalyzer->frequencies.first(), liveAnalyzer->frequencies.last());
+
+        liveInputButton->setText("Stop live input");
+
+        liveTimer->start();
+    }
+    else
+    {
+        liveTimer->stop();
+        liveAnalyzer->stopCapture();
+
+        for (QWidget *widget : liveDisabledWidgets)
+        {
+            widget->setEnabled(true);
+        }
+
+        liveDisabledWidgets.clear();
+
+        // A stage started meanwhile may still be reading the loaded file
+
+        updateFileActions();
+
+        liveSpectrogramData = nullptr;
+
+        liveInputButton->setText("Live input");
+        latencyLabel->setText("Latency: -");
+        latencyLabel->setStyleSheet("");
+
+        // Back to the analysis of the loaded file, if any
+
+        if (!fourier->spectra.isEmpty())
+        {
+            setSpectrogram();
+
+            spectrumGraph->xAxis->setRange(fourier->frequencies.first(), fourier->frequencies.last());
+            spectrumGraph->yAxis->setRange(0, fourier->supPower);
+
+            replotSpectrumGraph(player->position());
+        }
+        else
+        {
+            spectrumGraph->graph(0)->data()->clear();
+            spectrumGraph->replot();
+
+            spectrogram->data()->clear();
+            spectrogramGraph->replot();
+        }
+    }
+}
+
+void MainWindow::updateLiveGraphs()
+{
+    QVector<LiveAnalyzer::Row> rows = liveAnalyzer->takeRows();
+
+    if (rows.isEmpty())
+    {
+        return;
+    }
+
+    for (const LiveAnalyzer::Row &row : rows)
+    {
+        liveSupPower = std::max(liveSupPower, *std::max_element(row.power.begin(), row.power.end()));
+    }
+
+    const LiveAnalyzer::Row &newest = rows.last();
+
+    spectrumGraph->graph(0)->setData(liveAnalyzer->frequencies, newest.power, true);
+    spectrumGraph->yAxis->setRange(0, liveSupPower);
+    spectrumGraph->replot(QCustomPlot::rpImmediateRefresh);
+
+    // The last ten seconds scroll through the spectrogram: only the columns of the new rows are written
+
+    int nx = liveSpectrogramData->keySize();
+    int ny = liveSpectrogramData->valueSize();
+    int nNew = std::min(rows.size(), nx);
+
+    scrollColumns(liveSpectrogramData, nNew);
+
+    for (int i = 0; i < nNew; i++)
+    {
+        const QVector<double> &power = rows[rows.size() - nNew + i].power;
+        int xIndex = nx - nNew + i;
+
+        for (int yIndex = 0; yIndex < ny; yIndex++)
+        {
+            liveSpectrogramData->setCell(xIndex, yIndex, power[yIndex]);
+        }
+    }
+
+    liveSpectrogramData->setKeyRange(QCPRange(newest.time - (nx - 1) * liveAnalyzer->hopSeconds(), newest.time));
+
+    spectrogram->rescaleDataRange();
+    spectrogramGraph->rescaleAxes();
+    spectrogramGraph->replot(QCustomPlot::rpImmediateRefresh);
+
+    // From the capture of the newest segment's last frame to its plot, plus the device buffer ahead of the callback
+    // Measured once both graphs are repainted. Shown in red beyond a segment duration
+
+    double latency = (liveAnalyzer->elapsed() - newest.captureTime) / 1.0e6 + liveAnalyzer->deviceLatency;
+
+    latencyLabel->setText(QString("Latency: %1 ms").arg(latency, 0, 'f', 1));
+    latencyLabel->setStyleSheet(latency > liveAnalyzer->milliseconds ? "color: red;" : "");
+}
+
+void MainWindow::updateProgress()
+{
+    // Stages running now or at the previous refresh, which then shows their final counts
+    // Threads are checked before their counters are read, so the timer stops after that final refresh
+
+    QList<QThread*> running;
+
+    for (QThread *thread : std::initializer_list<QThread*>{ fourier, pitch, spectralFeatures, pca, kmeans })
+    {
+        if (thread->isRunning())
+        {
+            running.push_back(thread);
+        }
+    }
+
+    auto refresh = [&](QThread *thread){ return running.contains(thread) || progressThreads.contains(thread); };
+
+    if (refresh(fourier))
+    {
+        setProgressBar(fftProgressBar, fourier->progress, running.contains(fourier));
+    }
+    if (refresh(pitch))
+    {
+        setProgressBar(pitchProgressBar, pitch->progress, running.contains(pitch));
+    }
+    if (refresh(pca))
+    {
+        setProgressBar(pcaProgressBar, pca->progress, running.contains(pca));
+        pcaIterationLabel->setText(QString("Iteration: %1").arg(pca->progress.iteration()));
+    }
+    if (refresh(spectralFeatures) && !running.contains(kmeans))
+    {
+        iterationLabel->setText(QString("Features: %1%").arg(qRound(100 * spectralFeatures->progress.fraction())));
+    }
+    if (refresh(kmeans))
+    {
+        iterationLabel->setText(QString("Iteration: %1 (%2/s)").arg(kmeans->progress.iteration()).arg(kmeans->progress.rate(), 0, 'f', 1));
+    }
+
+    progressThreads = running;
+
+    if (running.isEmpty())
+    {
+        progressTimer->stop();
+    }
+}
+
+void MainWindow::setProgressBar(QProgressBar *bar, const Progress &progress, bool running)
+{
+    // Without a total the bar is busy while running and full once done
+    // Otherwise it shows the fraction done, throughput and time left
+
+    if (progress.totalCount() <= 0)
+    {
+        bar->setRange(0, running ? 0 : 1);
+        bar->setValue(running ? 0 : 1);
+        bar->setFormat("%p%");
+        return;
+    }
+
+    bar->setRange(0, 1000);
+    bar->setValue(qRound(1000 * progress.fraction()));
+
+    QString format = "%p%";
+
+    double rate = progress.rate();
+
+    if (rate > 0)
+    {
+        format += QString(" - %1 %2/s").arg(rate, 0, 'f', rate < 10 ? 1 : 0).arg(progress.unit());
+    }
+
+    double remaining = progress.remainingSeconds();
+
+    if (running && remaining >= 0)
+    {
+        format += QString(" - %1 left").arg(msToTime(qRound(remaining * 1000)));
+    }
+
+    bar->setFormat(format);
+}
+
+void MainWindow::resetProgressBar(QProgressBar *bar)
+{
+    bar->setRange(0, 1000);
+    bar->setValue(0);
+    bar->setFormat("%p%");
+}
+
 QString MainWindow::msToTime(int ms)
 {
     QTime zero(0, 0, 0);
@@ -1332,7 +2248,7 @@ QString MainWindow::msToTime(int ms)
     return time.toString();
 }
 
-void MainWindow::onDataFileSelected(const QString path)
+void MainWindow::loadData(const QString path)
 {
     currentClusterButton = nullptr;
 
@@ -1340,11 +2256,62 @@ void MainWindow::onDataFileSelected(const QString path)
 
     playPauseButton->setEnabled(false);
 
-    positionLabel->setText(QString("00:00:00 / %1").arg(msToTime(fourier->duration)));
+    positionLabel->setText(QString("%1 / %2").arg(msToTime(static_cast<int>(segmentPosition(0)))).arg(msToTime(regionEndPosition())));
 
     setWindowTitle(QString("Pitch Explorer - %1").arg(path));
 }
 
+void MainWindow::prePlanFFTs()
+{
+    if (!prePlanCheckBox->isChecked() || fourier->sampleNumber == 0)
+    {
+        return;
+    }
+
+    // The current segment duration goes first
+
+    planner->prePlan(fourier->sampleRate, fourier->sampleNumber, fourier->samplesAlignment(), fourier->milliseconds, fourier->hopMilliseconds, fourier->window != Fourier::Rectangular && fourier->scale != FilterBank::ConstantQ, fourier->padToSmoothSize);
+}
+
+void MainWindow::updateCacheSizeLabel()
+{
+    cacheSizeLabel->setText(QString("%1 files, %2 MB").arg(AudioCache::entryCount()).arg(AudioCache::size() >> 20));
+}
+
+void MainWindow::clearCache()
+{
+    // Removing a mapped entry leaves the mapping valid until it is released
+
+    AudioCache::clear();
+    updateCacheSizeLabel();
+}
+
+void MainWindow::exportBinaryDataFile()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Export binary data", QString(), tr("Binary data files (*.pxd)"));
+
+    if (path.isEmpty())
+    {
+        return;
+    }
+
+    if (!path.endsWith(".pxd"))
+    {
+        path.append(".pxd");
+    }
+
+    if (!fourier->writeBinaryDataFile(path))
+    {
+        QMessageBox *errorBox = new QMessageBox(this);
+
+        errorBox->setWindowTitle("Error");
+
+        errorBox->setText("Failed to write binary data file.");
+
+        errorBox->exec();
+    }
+}
+
 void MainWindow::showSpectrumPointValue(QMouseEvent *event)
 {
     if (!spectrumGraph->graph(0)->data()->isEmpty())
@@ -1399,28 +2366,36 @@ void MainWindow::toggleYAxisScale(int state)
 
 void MainWindow::setWaveFormGraph()
 {
-    waveFormGraph->graph(0)->setData(fourier->times, fourier->waveForm, true);
-    waveFormGraph->xAxis->setRange(fourier->times.first(), milliseconds / 1000.0);
+    waveForm->setData(fourier->samples[fourier->displayedChannel()], static_cast<int>(fourier->sampleNumber), fourier->sampleRate, fourier->minWaveForm, fourier->maxWaveForm, fourier->minTime);
+    waveFormGraph->xAxis->setRange(fourier->minTime, fourier->minTime + segmentSeconds());
     waveFormGraph->yAxis->setRange(fourier->minWaveForm, fourier->maxWaveForm);
     waveFormGraph->replot();
 }
 
 void MainWindow::shiftWaveFormGraph(qint64 position)
 {
-    int index = static_cast<int>(position / milliseconds);
-    double conversion = milliseconds / 1000.0;
-    waveFormGraph->xAxis->setRange(index * conversion, (index + 1) * conversion);
+    double start = std::max(segmentIndex(position), 0) * hopSeconds();
+    waveFormGraph->xAxis->setRange(fourier->minTime + start, fourier->minTime + start + segmentSeconds());
     waveFormGraph->replot();
 }
 
 void MainWindow::setWaveFormFullGraph()
 {
-    waveFormFullGraph->graph(0)->setData(fourier->times, fourier->waveForm, true);
-    waveFormFullGraph->xAxis->setRange(fourier->times.first(), fourier->times.last());
+    waveFormFull->setData(fourier->samples[fourier->displayedChannel()], static_cast<int>(fourier->sampleNumber), fourier->sampleRate, fourier->minWaveForm, fourier->maxWaveForm, fourier->minTime);
+    waveFormFullGraph->xAxis->setRange(fourier->minTime, fourier->maxTime);
     waveFormFullGraph->yAxis->setRange(fourier->minWaveForm, fourier->maxWaveForm);
     waveFormFullGraph->replot();
+}
+
+void MainWindow::clearWaveFormGraphs()
+{
+    startFFTAnalysisButton->setEnabled(false);
 
-    fourier->clearWaveFormData();
+    waveForm->clearData();
+    waveFormGraph->replot();
+
+    waveFormFull->clearData();
+    waveFormFullGraph->replot();
 }
 
 void MainWindow::shiftWaveFormFullCursor(qint64 position)
@@ -1432,7 +2407,7 @@ void MainWindow::shiftWaveFormFullCursor(qint64 position)
 
 void MainWindow::shiftSpectrogramCursor(qint64 position)
 {
-    if (!fourier->spectra.empty())
+    if (!fourier->spectra.isEmpty())
     {
         spectrogramCursor->start->setCoords(position / 1000.0, 0);
         spectrogramCursor->end->setCoords(position / 1000.0, 1.0e6);
@@ -1442,18 +2417,27 @@ void MainWindow::shiftSpectrogramCursor(qint64 position)
 
 void MainWindow::setSpectrogram()
 {
-    int nx = fourier->spectra.size();
+    int nx = fourier->spectra.rows();
     int ny = fourier->frequencies.size();
 
     spectrogram->data()->setSize(nx, ny);
-    spectrogram->data()->setRange(QCPRange(fourier->minTime, fourier->maxTime), QCPRange(fourier->frequencies.first(), fourier->frequencies.last()));
+
+    // Cells are centered on their segments
+
+    double firstCenter = fourier->minTime + segmentSeconds() / 2;
+    double lastCenter = firstCenter + std::max(nx - 1, 0) * hopSeconds();
+
+    spectrogram->data()->setRange(QCPRange(firstCenter, lastCenter), setFrequencyAxis(fourier->spectraScale(), fourier->frequencies));
+
+    std::vector<Real> buffer(static_cast<size_t>(fourier->spectra.columns()));
 
     for (int xIndex = 0; xIndex < nx; xIndex++)
     {
+        const Real *row = fourier->spectra.row(xIndex, buffer.data());
+
         for (int yIndex = 0; yIndex < ny; yIndex++)
         {
-            double z = fourier->spectra[xIndex][yIndex];
-            spectrogram->data()->setCell(xIndex, yIndex, z);
+            spectrogram->data()->setCell(xIndex, yIndex, row[yIndex]);
         }
     }
 
@@ -1462,6 +2446,131 @@ void MainWindow::setSpectrogram()
     spectrogramGraph->replot();
 
     shiftSpectrogramCursor(0);
+
+    setPitchGraph();
+}
+
+QCPRange MainWindow::setFrequencyAxis(FilterBank::Scale scale, const QVector<double> &frequencies)
+{
+    // Filter bank bands are not evenly spaced in frequency: cells are laid out by band, labelled with their center frequencies
+
+    if (scale == FilterBank::Linear)
+    {
+        spectrogramGraph->yAxis->setTicker(QSharedPointer<QCPAxisTicker>(new QCPAxisTicker));
+
+        return QCPRange(frequencies.first(), frequencies.last());
+    }
+
+    int ny = frequencies.size();
+
+    QSharedPointer<QCPAxisTickerText> bandTicker(new QCPAxisTickerText);
+
+    for (int band = 0; band < ny; band += std::max(1, ny / 8))
+    {
+        bandTicker->addTick(band, QString::number(qRound(frequencies[band])));
+    }
+
+    spectrogramGraph->yAxis->setTicker(bandTicker);
+
+    return QCPRange(0, ny - 1);
+}
+
+double MainWindow::spectrogramValue(double frequency) const
+{
+    // Filter bank rows are band indexes: interpolate between the nearest band centers, logarithmically
+
+    const QVector<double> &centers = fourier->frequencies;
+
+    if (fourier->spectraScale() == FilterBank::Linear || qIsNaN(frequency))
+    {
+        return frequency;
+    }
+
+    if (centers.isEmpty() || frequency < centers.first() || frequency > centers.last())
+    {
+        return qQNaN();
+    }
+
+    int band = static_cast<int>(std::upper_bound(centers.begin(), centers.end(), frequency) - centers.begin()) - 1;
+
+    if (band >= centers.size() - 1)
+    {
+        return centers.size() - 1;
+    }
+
+    return band + log(frequency / centers[band]) / log(centers[band + 1] / centers[band]);
+}
+
+void MainWindow::setPitchGraph()
+{
+    if (pitch->frequencies.isEmpty())
+    {
+        pitchGraph->data()->clear();
+        spectrogramGraph->replot();
+        return;
+    }
+
+    QVector<double> values(pitch->frequencies.size());
+
+    for (int i = 0; i < values.size(); i++)
+    {
+        values[i] = spectrogramValue(pitch->frequencies[i]);
+    }
+
+    pitchGraph->setData(pitch->times, values, true);
+
+    spectrogramGraph->replot();
+}
+
+void MainWindow::clearPitchGraph()
+{
+    pitch->clearPitchData();
+
+    if (onPitchData->isChecked())
+    {
+        onFFTData->setChecked(true);
+    }
+
+    onPitchData->setEnabled(false);
+
+    resetProgressBar(pitchProgressBar);
+
+    pitchGraph->data()->clear();
+    spectrogramGraph->replot();
+}
+
+void MainWindow::performPitchTracking()
+{
+    // Same segments as the spectra, on the samples of the displayed channel, which must stay loaded meanwhile
+
+    trackPitchButton->setText("Computing...");
+    trackPitchButton->setEnabled(false);
+
+    loadAudioFileButton->setEnabled(false);
+    loadDataFileButton->setEnabled(false);
+    startFFTAnalysisButton->setEnabled(false);
+    channelComboBox->setEnabled(false);
+    minPitchSpinBox->setEnabled(false);
+    maxPitchSpinBox->setEnabled(false);
+
+    pitch->initData(fourier->samples[fourier->displayedChannel()], fourier->sampleNumber, fourier->sampleRate, milliseconds, hopMilliseconds, fourier->minTime);
+
+    resetProgressBar(pitchProgressBar);
+
+    pitch->trackPitch();
+}
+
+void MainWindow::onPitchPerformed()
+{
+    trackPitchButton->setText("Track pitch");
+    trackPitchButton->setEnabled(true);
+
+    minPitchSpinBox->setEnabled(true);
+    maxPitchSpinBox->setEnabled(true);
+
+    onPitchData->setEnabled(!pitch->features.isEmpty());
+
+    setPitchGraph();
 }
 
 void MainWindow::clearFFTGraphs()
@@ -1478,6 +2587,9 @@ void MainWindow::clearFFTGraphs()
     spectrogram->rescaleDataRange();
     spectrogramGraph->rescaleAxes();
     spectrogramGraph->replot();
+
+    clearPitchGraph();
+    spectralFeatures->clearFeaturesData();
 }
 
 void MainWindow::setPCAGraphs()
@@ -1718,9 +2830,9 @@ void MainWindow::selectCurrentPCAPoint(qint64 position)
 {
     if (!pca->pc1.empty())
     {
-        int index = static_cast<int>(position / milliseconds);
+        int index = segmentIndex(position);
 
-        if (index < pca->pc1.size())
+        if (index >= 0 && index < pca->pc1.size())
         {
             QVector<double> pc1Sel(1, pca->pc1[index]);
             QVector<double> pc2Sel(1, pca->pc2[index]);
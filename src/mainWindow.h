@@ -2,9 +2,15 @@
 #define MAINWINDOW_H
 
 #include "fourier.h"
+#include "liveAnalyzer.h"
+#include "colorMapScroll.h"
+#include "audioCache.h"
 #include "pca.h"
 #include "kmeans.h"
 #include "hurst.h"
+#include "pitch.h"
+#include "spectralFeatures.h"
+#include "waveFormPlottable.h"
 #include "flowLayout.h"
 #include "qcustomplot.h"
 #include <array>
@@ -14,11 +20,15 @@
 #include <QGridLayout>
 #include <QLabel>
 #include <QSpinBox>
+#include <QLineEdit>
+#include <QDoubleSpinBox>
 #include <QProgressBar>
 #include <QMediaPlayer>
 #include <QCheckBox>
+#include <QComboBox>
 #include <QRadioButton>
 #include <QTabWidget>
+#include <QTimer>
 
 class MainWindow : public QWidget
 {
@@ -50,11 +60,23 @@ private slots:
     void onHurstNotEnoughData();
     void updateComponentNumber(int value);
     void updateSegmentDuration(int value);
+    void updateHop(int value);
+    void updateExtraDurations();
     void updateFrequencyBinSize(int value);
+    void updateScale();
     void updateClusterNumber(int value);
-    void updateFFTProgressBarMaximum();
+    void selectChannel(int index);
+    void onAudioFileSelected(const QString path);
     void onDataFileSelected(const QString path);
+    void onLoadStarted(const QString path);
+    void onFileRead();
+    void onLoadFailed();
+    void exportBinaryDataFile();
+    void prePlanFFTs();
+    void updateCacheSizeLabel();
+    void clearCache();
     void loadAudio(const QString path);
+    void loadData(const QString path);
     void togglePlayback(bool checked);
     void selectCurrentSegment(qint64 position);
     void changePlaybackPosition(int index);
@@ -71,6 +93,7 @@ private slots:
     void showSpectrumPointValue(QMouseEvent *event);
     void setWaveFormGraph();
     void setWaveFormFullGraph();
+    void clearWaveFormGraphs();
     void shiftWaveFormFullCursor(qint64 position);
     void setSpectrogram();
     void shiftSpectrogramCursor(qint64 position);
@@ -84,15 +107,29 @@ private slots:
     void setRescaledRangeGraph();
     void setIntervalGraph();
     void setCumulativeIntervalGraph();
+    void toggleLiveInput(bool checked);
+    void updateLiveGraphs();
+    void showCaptureFailedDialog(QString message);
+    void performPitchTracking();
+    void onPitchPerformed();
+    void setPitchGraph();
+    void clearPitchGraph();
+    void updateProgress();
+    void updateFileActions();
 
 private:
+    FFTPlanner *planner;
     Fourier *fourier;
+    LiveAnalyzer *liveAnalyzer;
     PCA *pca;
     KMeans *kmeans;
     Hurst *hurst;
+    Pitch *pitch;
+    SpectralFeatures *spectralFeatures;
 
     QPushButton *loadAudioFileButton;
     QPushButton *loadDataFileButton;
+    QPushButton *exportBinaryDataFileButton;
     QPushButton *aboutButton;
     QPushButton *helpButton;
     QPushButton *startFFTAnalysisButton;
@@ -100,29 +137,58 @@ private:
     QPushButton *abortPCAButton;
     QPushButton *startKMeansButton;
     QPushButton *startHurstButton;
+    QPushButton *clearCacheButton;
+    QPushButton *liveInputButton;
+    QPushButton *trackPitchButton;
 
     QFileDialog *loadAudioFileDialog;
     QFileDialog *loadDataFileDialog;
 
     QLabel *sampleRateLabel;
+    QLabel *latencyLabel;
     QLabel *samplesPerSegmentLabel;
+    QLabel *fftSizeLabel;
     QLabel *segmentsLabel;
     QLabel *frequenciesLabel;
     QLabel *frequencyBinsLabel;
+    QLabel *spectraSizeLabel;
     QLabel *iterationLabel;
     QLabel *pcaIterationLabel;
     QLabel *hurstExponentLabel;
+    QLabel *cacheSizeLabel;
 
     QSpinBox *segmentDurationSpinBox;
+    QSpinBox *hopSpinBox;
+    QComboBox *windowComboBox;
+    QComboBox *scaleComboBox;
+    QComboBox *storageComboBox;
+    QSpinBox *filterBandsSpinBox;
+    QSpinBox *bandsPerOctaveSpinBox;
     QSpinBox *frequencyBinSizeSpinBox;
     QSpinBox *componentNumberSpinBox;
     QSpinBox *clusterNumberSpinBox;
+    QSpinBox *minPitchSpinBox;
+    QSpinBox *maxPitchSpinBox;
+    QDoubleSpinBox *regionStartSpinBox;
+    QDoubleSpinBox *regionEndSpinBox;
+    QLineEdit *extraDurationsLineEdit;
+
+    QCheckBox *keepChannelsCheckBox;
+    QCheckBox *useCacheCheckBox;
+    QCheckBox *prePlanCheckBox;
+    QCheckBox *padCheckBox;
+    QSpinBox *cacheLimitSpinBox;
+    QComboBox *analysisSampleRateComboBox;
+    QComboBox *channelComboBox;
 
     QProgressBar *fftProgressBar;
     QProgressBar *pcaProgressBar;
+    QProgressBar *pitchProgressBar;
 
     QRadioButton *onPCAData;
     QRadioButton *onFFTData;
+    QRadioButton *onPitchData;
+    QRadioButton *onFeatureData;
 
     FlowLayout *clusterButtonsLayout;
     QVector<QPushButton*> clusterButtons;
@@ -130,6 +196,7 @@ private:
     int currentClusterButtonIndex;
     int clusterNumber;
     int milliseconds;
+    int hopMilliseconds;
 
     QMediaPlayer *player;
     QLabel *positionLabel;
@@ -141,13 +208,16 @@ private:
     QCheckBox *yAxisScaleCheckBox;
 
     QCustomPlot *waveFormGraph;
+    WaveFormPlottable *waveForm;
 
     QCustomPlot *waveFormFullGraph;
+    WaveFormPlottable *waveFormFull;
     QCPItemLine *waveFormFullCursor;
 
     QCustomPlot *spectrogramGraph;
     QCPColorMap *spectrogram;
     QCPItemLine *spectrogramCursor;
+    QCPGraph *pitchGraph;
 
     QCustomPlot *pc1pc2Graph;
     QCustomPlot *pc1pc3Graph;
@@ -173,7 +243,37 @@ private:
 
     QTabWidget *graphsTabWidget;
 
+    QString filePath;
+    bool audioFileSelected;
+
+    // A load is running on the Fourier thread, the samples it holds until then are those of the previous file
+    // The samples shown are analysable only once a load succeeds
+    bool loadPending;
+    bool samplesShown;
+
+    // Live input: spectrogram cells scrolled as rows arrive, refreshed by the timer, owned by the color map
+    QTimer *liveTimer;
+    QCPColorMapData *liveSpectrogramData;
+    double liveSupPower;
+    QList<QWidget*> liveDisabledWidgets;
+
+    // Worker progress, polled while any stage runs
+    QTimer *progressTimer;
+    QList<QThread*> progressThreads;
+
+    int segmentIndex(qint64 position);
+    qint64 segmentPosition(int index);
+    double segmentSeconds() const;
+    double hopSeconds() const;
+    int regionEndPosition();
     int computeSegmentNumber();
+    void setFFTSizeLabel(int nSamplesPerSegment);
+    void setProgressBar(QProgressBar *bar, const Progress &progress, bool running);
+    void resetProgressBar(QProgressBar *bar);
+    void onSpectraChanged();
+    void rebinSpectra();
+    double spectrogramValue(double frequency) const;
+    QCPRange setFrequencyAxis(FilterBank::Scale scale, const QVector<double> &frequencies);
     void createClusterButtons();
     void setConvexHulls(const QVector<QVector<std::array<double, 2>>> &points, QCustomPlot *graph);
     QVector<std::array<double, 2>> computeConvexHulls(QVector<std::array<double, 2>> points);
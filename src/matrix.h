@@ -0,0 +1,95 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <QtGlobal>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+// Dense row-major matrix, the format in which spectra, principal components and clustering data pass between stages.
+// Storage is a single block aligned to a cache line, and rows are padded to whole cache lines, so that every row
+// starts aligned. The padding is zero: kernels may run over a whole stride.
+// Copies share their storage, as Qt containers do, so a stage that only reads holds a copy at no cost.
+// Rows are read through row() and written through mutableRow(), which first detaches shared storage.
+
+template <typename T>
+class Matrix
+{
+    static_assert(std::is_arithmetic<T>::value, "Matrix elements must be arithmetic");
+
+public:
+    static constexpr int alignment = 64;
+
+    Matrix() : nRows(0), nColumns(0), rowStride(0) {}
+
+    Matrix(int rows, int columns) : nRows(rows), nColumns(columns), rowStride(paddedStride(columns))
+    {
+        storage = allocate(size());
+    }
+
+    int rows() const { return nRows; }
+    int columns() const { return nColumns; }
+    int stride() const { return rowStride; }
+    bool isEmpty() const { return nRows == 0; }
+
+    const T *row(int i) const { return storage.get() + static_cast<qint64>(i) * rowStride; }
+    const T *operator[](int i) const { return row(i); }
+    T at(int i, int j) const { return row(i)[j]; }
+
+    T *mutableRow(int i)
+    {
+        detach();
+        return storage.get() + static_cast<qint64>(i) * rowStride;
+    }
+
+    void clear()
+    {
+        nRows = 0;
+        nColumns = 0;
+        rowStride = 0;
+        storage.reset();
+    }
+
+private:
+    int nRows;
+    int nColumns;
+    int rowStride;
+    std::shared_ptr<T> storage;
+
+    size_t size() const
+    {
+        return static_cast<size_t>(nRows) * static_cast<size_t>(rowStride);
+    }
+
+    static int paddedStride(int columns)
+    {
+        const int lane = alignment / static_cast<int>(sizeof(T));
+        return (columns + lane - 1) / lane * lane;
+    }
+
+    static std::shared_ptr<T> allocate(size_t n)
+    {
+        if (n == 0)
+        {
+            return std::shared_ptr<T>();
+        }
+
+        T *data = static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignment)));
+        std::fill(data, data + n, T(0));
+
+        return std::shared_ptr<T>(data, [](T *p){ ::operator delete(p, std::align_val_t(alignment)); });
+    }
+
+    void detach()
+    {
+        if (storage.use_count() > 1)
+        {
+            std::shared_ptr<T> copy = allocate(size());
+            std::copy(storage.get(), storage.get() + size(), copy.get());
+            storage = copy;
+        }
+    }
+};
+
+#endif
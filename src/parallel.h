@@ -0,0 +1,88 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "progress.h"
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Pools of threads for the stages made of many independent items: segments, batches of segments, rows, pieces of a file.
+// A pool has as many workers as the ideal thread count, never more than there are items. Workers take the next item
+// from a shared counter as they finish the last one, so that uneven items balance out, and no item is handed out once
+// the stage is interrupted. Results must not depend on which worker takes which item.
+
+class Parallel
+{
+public:
+    // Hands out item indexes in turn, then -1 once all are taken or the stage is interrupted
+    class Items
+    {
+    public:
+        Items(int newCount, const std::function<bool()> &newInterrupted) : count(newCount), interrupted(newInterrupted), nextIndex(0) {}
+
+        int next()
+        {
+            int index = nextIndex++;
+            return index < count && !(interrupted && interrupted()) ? index : -1;
+        }
+
+    private:
+        int count;
+        const std::function<bool()> &interrupted;
+        std::atomic<int> nextIndex;
+    };
+
+    static int workerCount(int count)
+    {
+        return std::max(0, std::min(QThread::idealThreadCount(), count));
+    }
+
+    // worker(w, items) on each worker w, which sets up what it needs before taking its first item
+
+    template <typename Worker>
+    static void run(int count, const std::function<bool()> &interrupted, Worker worker)
+    {
+        Items items(count, interrupted);
+
+        int nWorkers = workerCount(count);
+
+        std::vector<std::thread> threads;
+
+        for (int w = 0; w < nWorkers; w++)
+        {
+            threads.emplace_back([&worker, &items, w]()
+            {
+                worker(w, items);
+            });
+        }
+
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    // body(index) for every item, advancing progress by one item each when given
+
+    template <typename Body>
+    static void forEach(int count, const std::function<bool()> &interrupted, Progress *progress, Body body)
+    {
+        run(count, interrupted, [&body, progress](int, Items &items)
+        {
+            for (int index = items.next(); index >= 0; index = items.next())
+            {
+                body(index);
+
+                if (progress != nullptr)
+                {
+                    progress->advance();
+                }
+            }
+        });
+    }
+};
+
+#endif
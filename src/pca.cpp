@@ -1,4 +1,6 @@
 #include "pca.h"
+#include <algorithm>
+#include <vector>
 #include <math.h>
 
 PCA::PCA(QObject *parent) : QThread(parent)
@@ -15,41 +17,35 @@ PCA::~PCA()
     wait();
 }
 
-void PCA::initData(QVector<QVector<double>> receivedData)
+void PCA::initData(const CompactMatrix &receivedData)
 {
     data = receivedData;
 }
 
-void PCA::centerColumns()
+void PCA::obtainColumnMeans()
 {
-    int nRows = data.size();
-    int nCols = data[0].size();
+    int nRows = data.rows();
+    int nCols = data.columns();
 
-    // Obtain means
+    mean.fill(0, nCols);
 
-    QVector<double> mean(nCols, 0);
+    double *m = mean.data();
+
+    std::vector<Real> buffer(static_cast<size_t>(nCols));
 
     for (int row = 0; row < nRows; row++)
     {
+        const Real *x = data.row(row, buffer.data());
+
         for (int col = 0; col < nCols; col++)
         {
-            mean[col] += data[row][col];
+            m[col] += x[col];
         }
     }
 
     for (int col = 0; col < nCols; col++)
     {
-        mean[col] /= nRows;
-    }
-
-    // Center columns
-
-    for (int row = 0; row < nRows; row++)
-    {
-        for (int col = 0; col < nCols; col++)
-        {
-            data[row][col] -= mean[col];
-        }
+        m[col] /= nRows;
     }
 }
 
@@ -61,10 +57,18 @@ void PCA::performPCA()
 
 void PCA::run()
 {
-    centerColumns();
+    // Data are shared with the spectra, not copied: columns are centered implicitly,
+    // subtracting the means' contribution from each product instead of from each element
+    // Compact spectra are decoded a row at a time into a buffer, just before each product uses it
+
+    obtainColumnMeans();
+
+    int nRows = data.rows();
+    int nCols = data.columns();
 
-    int nRows = data.size();
-    int nCols = data[0].size();
+    const double *m = mean.constData();
+
+    std::vector<Real> buffer(static_cast<size_t>(nCols));
 
     double tolerance = 1.0e-7;
 
@@ -73,8 +77,7 @@ void PCA::run()
 
     QVector<double> eigenvalue(componentNumber, 0);
 
-    int step = 0;
-    emit(pcaStep(step));
+    progress.start(componentNumber, "components");
 
     for (int k = 0; k < componentNumber; k++)
     {
@@ -88,36 +91,64 @@ void PCA::run()
         bool iterate = true;
 
         int iterationStep = 0;
-        emit(pcaIterationStep(iterationStep));
+        progress.setIteration(iterationStep);
 
         while (iterate)
         {
             if (abort)
             {
+                progress.finish();
                 emit(pcaAborted());
                 return;
             }
 
-            // Compute new variable loadings
+            double *r = rowScore[k].data();
+            double *c = colScore[k].data();
 
-            for (int col = 0; col < nCols; col++)
+            // Compute new variable loadings, accumulating row by row along contiguous rows
+
+            std::fill(c, c + nCols, 0.0);
+
+            double rowScoreSum = 0;
+
+            for (int row = 0; row < nRows; row++)
             {
-                colScore[k][col] = 0;
-                for (int row = 0; row < nRows; row++)
+                const Real *x = data.row(row, buffer.data());
+                double score = r[row];
+
+                for (int col = 0; col < nCols; col++)
                 {
-                    colScore[k][col] += data[row][col] * rowScore[k][row];
+                    c[col] += x[col] * score;
                 }
+
+                rowScoreSum += score;
+            }
+
+            for (int col = 0; col < nCols; col++)
+            {
+                c[col] -= m[col] * rowScoreSum;
             }
 
             // Compute new object scores
 
+            double meanProduct = 0;
+
+            for (int col = 0; col < nCols; col++)
+            {
+                meanProduct += m[col] * c[col];
+            }
+
             for (int row = 0; row < nRows; row++)
             {
-                rowScore[k][row] = 0;
+                const Real *x = data.row(row, buffer.data());
+                double product = 0;
+
                 for (int col = 0; col < nCols; col++)
                 {
-                    rowScore[k][row] += data[row][col] * colScore[k][col];
+                    product += x[col] * c[col];
                 }
+
+                r[row] = product - meanProduct;
             }
 
             if (k > 0)
@@ -163,7 +194,7 @@ void PCA::run()
             // Check for convergence
 
             iterationStep++;
-            emit(pcaIterationStep(iterationStep));
+            progress.setIteration(iterationStep);
 
             if (fabs(eigenvalue[k] - eigenvalueEstimate) < tolerance)
             {
@@ -198,27 +229,23 @@ void PCA::run()
             rowScore[k][row] *= scale;
         }
 
-        step++;
-        emit(pcaStep(step));
+        progress.advance();
     }
 
     eigenvalues = eigenvalue;
 
     // Format principal components for use in K-Means
 
-    principalComponents.clear();
-    principalComponents.reserve(nRows);
-
-    QVector<double> components(componentNumber);
+    principalComponents = Matrix<Real>(nRows, componentNumber);
 
     for (int row = 0; row < nRows; row++)
     {
+        Real *components = principalComponents.mutableRow(row);
+
         for (int k = 0; k < componentNumber; k++)
         {
-            components[k] = rowScore[k][row];
+            components[k] = static_cast<Real>(rowScore[k][row]);
         }
-
-        principalComponents.push_back(components);
     }
 
     // PC1, PC2 and PC3 for plotting
@@ -276,7 +303,9 @@ void PCA::run()
     }
 
     data.clear();
-    data.shrink_to_fit();
+    mean.clear();
+
+    progress.finish();
 
     emit(pcaPerformed());
 }
@@ -1,6 +1,10 @@
 #ifndef PCA_H
 #define PCA_H
 
+#include "precision.h"
+#include "matrix.h"
+#include "compactMatrix.h"
+#include "progress.h"
 #include <QThread>
 
 class PCA : public QThread
@@ -13,21 +17,20 @@ public:
 
     int componentNumber;
     QVector<double> eigenvalues;
-    QVector<QVector<double>> principalComponents;
+    Matrix<Real> principalComponents;
     QVector<double> pc1, pc2, pc3;
     double pc1Min, pc1Max;
     double pc2Min, pc2Max;
     double pc3Min, pc3Max;
 
     bool abort;
+    Progress progress;
 
-    void initData(QVector<QVector<double>> receivedData);
+    void initData(const CompactMatrix &receivedData);
     void performPCA();
     void clearPCAData();
 
 signals:
-    void pcaIterationStep(int iterationStep);
-    void pcaStep(int step);
     void pcaPerformed();
     void pcaAborted();
 
@@ -35,9 +38,10 @@ protected:
     void run() override;
 
 private:
-    QVector<QVector<double>> data;
+    CompactMatrix data;
+    QVector<double> mean;
 
-    void centerColumns();
+    void obtainColumnMeans();
 };
 
 #endif
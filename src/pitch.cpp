@@ -0,0 +1,288 @@
+#include "pitch.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+
+Pitch::Pitch(QObject *parent) : QThread(parent)
+{
+    minFrequency = 50;
+    maxFrequency = 1000;
+    threshold = 0.15;
+    segmentNumber = 0;
+
+    samples = nullptr;
+    sampleNumber = 0;
+    sampleRate = 0;
+    milliseconds = 0;
+    hopMilliseconds = 0;
+    minTime = 0;
+    nSamples = 0;
+    nHop = 1;
+    minPeriod = 0;
+    maxPeriod = 0;
+    frequencyData = nullptr;
+    periodicityData = nullptr;
+}
+
+Pitch::~Pitch()
+{
+    quit();
+    requestInterruption();
+    wait();
+}
+
+void Pitch::initData(const Real *receivedSamples, unsigned long receivedSampleNumber, int receivedSampleRate, int segmentMilliseconds, int segmentHopMilliseconds, double startTime)
+{
+    samples = receivedSamples;
+    sampleNumber = receivedSampleNumber;
+    sampleRate = receivedSampleRate;
+    milliseconds = segmentMilliseconds;
+    hopMilliseconds = segmentHopMilliseconds;
+    minTime = startTime;
+
+    // Same segmentation as the FFT analysis, one estimate per row of spectra
+
+    nSamples = sampleRate * milliseconds / 1000;
+    nHop = std::max(1, sampleRate * hopMilliseconds / 1000);
+    segmentNumber = FFTPlanner::segmentNumber(static_cast<int>(sampleNumber), nSamples, nHop);
+}
+
+void Pitch::trackPitch()
+{
+    start();
+}
+
+void Pitch::clearPitchData()
+{
+    times.clear();
+    frequencies.clear();
+    periodicities.clear();
+    features.clear();
+}
+
+void Pitch::run()
+{
+    int nSegments = segmentNumber;
+
+    progress.start(nSegments, "segments");
+
+    times.resize(nSegments);
+    frequencies.fill(qQNaN(), nSegments);
+    periodicities.fill(0, nSegments);
+    features = Matrix<Real>(nSegments, 2);
+
+    // Segment centers, from the whole samples each segment is cut at
+
+    for (int segment = 0; segment < nSegments; segment++)
+    {
+        times[segment] = minTime + (nSamples / 2.0 + static_cast<double>(segment) * nHop) / sampleRate;
+    }
+
+    // Workers write through these, never detaching shared data
+
+    frequencyData = frequencies.data();
+    periodicityData = periodicities.data();
+
+    featureRows.resize(static_cast<size_t>(nSegments));
+
+    for (int segment = 0; segment < nSegments; segment++)
+    {
+        featureRows[static_cast<size_t>(segment)] = features.mutableRow(segment);
+    }
+
+    // Periods from that of the maximum frequency to that of the minimum, at most half a segment,
+    // so that the difference function always sums over half a segment or more
+
+    minPeriod = std::max(2, static_cast<int>(ceil(static_cast<double>(sampleRate) / maxFrequency)));
+    maxPeriod = std::min(nSamples / 2, static_cast<int>(floor(static_cast<double>(sampleRate) / minFrequency)));
+
+    if (nSegments == 0 || maxPeriod < minPeriod + 2)
+    {
+        progress.finish();
+        emit(pitchPerformed());
+        return;
+    }
+
+    // No wrap around: the lagged part of the correlation never reaches past the segment
+
+    FFTPlanner::CorrelationPlans plans;
+    FFTPlanner::createCorrelationPlans(nSamples, plans);
+
+    Parallel::run(nSegments, [this](){ return isInterruptionRequested(); }, [this, &plans](int, Parallel::Items &items)
+    {
+        trackSegments(plans, items);
+    });
+
+    FFTPlanner::destroyCorrelationPlans(plans);
+
+    featureRows.clear();
+
+    progress.finish();
+
+    if (isInterruptionRequested())
+    {
+        clearPitchData();
+        return;
+    }
+
+    emit(pitchPerformed());
+}
+
+struct Pitch::Workspace
+{
+    Real *head;
+    Real *segment;
+    Real *correlation;
+    FFTW(complex) *headSpectrum;
+    FFTW(complex) *segmentSpectrum;
+    std::vector<double> energy;
+    std::vector<double> difference;
+};
+
+void Pitch::trackSegments(const FFTPlanner::CorrelationPlans &plans, Parallel::Items &items)
+{
+    int nFrequencies = nSamples / 2 + 1;
+
+    Workspace workspace;
+
+    workspace.head = FFTW(alloc_real)(static_cast<unsigned long>(nSamples));
+    workspace.segment = FFTW(alloc_real)(static_cast<unsigned long>(nSamples));
+    workspace.correlation = FFTW(alloc_real)(static_cast<unsigned long>(nSamples));
+    workspace.headSpectrum = FFTW(alloc_complex)(static_cast<unsigned long>(nFrequencies));
+    workspace.segmentSpectrum = FFTW(alloc_complex)(static_cast<unsigned long>(nFrequencies));
+    workspace.energy.resize(static_cast<size_t>(nSamples) + 1);
+    workspace.difference.resize(static_cast<size_t>(maxPeriod) + 1);
+
+    // Zero past the head, kept as the forward transform preserves its input
+
+    std::fill(workspace.head, workspace.head + nSamples, static_cast<Real>(0));
+
+    for (int s = items.next(); s >= 0; s = items.next())
+    {
+        trackSegment(s, plans, workspace);
+
+        progress.advance();
+    }
+
+    FFTW(free)(workspace.head);
+    FFTW(free)(workspace.segment);
+    FFTW(free)(workspace.correlation);
+    FFTW(free)(workspace.headSpectrum);
+    FFTW(free)(workspace.segmentSpectrum);
+}
+
+void Pitch::trackSegment(int s, const FFTPlanner::CorrelationPlans &plans, Workspace &workspace)
+{
+    int nFrequencies = nSamples / 2 + 1;
+    int nSum = nSamples - maxPeriod;
+
+    const Real *x = samples + static_cast<qint64>(s) * nHop;
+
+    FFTW(complex) *headSpectrum = workspace.headSpectrum;
+    FFTW(complex) *segmentSpectrum = workspace.segmentSpectrum;
+    const Real *correlation = workspace.correlation;
+    double *energy = workspace.energy.data();
+    double *difference = workspace.difference.data();
+
+    // Correlation of the first nSum samples with the whole segment: r(tau) = sum x(j) x(j + tau), j < nSum
+
+    std::copy(x, x + nSum, workspace.head);
+    std::copy(x, x + nSamples, workspace.segment);
+
+    FFTW(execute_dft_r2c)(plans.forward, workspace.head, headSpectrum);
+    FFTW(execute_dft_r2c)(plans.forward, workspace.segment, segmentSpectrum);
+
+    for (int k = 0; k < nFrequencies; k++)
+    {
+        Real re = headSpectrum[k][0] * segmentSpectrum[k][0] + headSpectrum[k][1] * segmentSpectrum[k][1];
+        Real im = headSpectrum[k][0] * segmentSpectrum[k][1] - headSpectrum[k][1] * segmentSpectrum[k][0];
+
+        headSpectrum[k][0] = re;
+        headSpectrum[k][1] = im;
+    }
+
+    FFTW(execute_dft_c2r)(plans.inverse, headSpectrum, workspace.correlation);
+
+    energy[0] = 0;
+
+    for (int j = 0; j < nSamples; j++)
+    {
+        energy[j + 1] = energy[j] + static_cast<double>(x[j]) * x[j];
+    }
+
+    // Silence is unvoiced and aperiodic
+
+    if (energy[nSamples] <= 0)
+    {
+        return;
+    }
+
+    // Difference function d(tau) = sum (x(j) - x(j + tau))^2 = e(0) + e(tau) - 2 r(tau),
+    // normalized by its cumulative mean: d'(tau) = d(tau) tau / sum d(1..tau)
+
+    double headEnergy = energy[nSum];
+    double cumulative = 0;
+
+    difference[0] = 1;
+
+    for (int tau = 1; tau <= maxPeriod; tau++)
+    {
+        double lagEnergy = energy[tau + nSum] - energy[tau];
+        double d = std::max(0.0, headEnergy + lagEnergy - 2.0 * correlation[tau] / nSamples);
+
+        cumulative += d;
+
+        difference[tau] = cumulative > 0 ? d * tau / cumulative : 1;
+    }
+
+    // First dip below the threshold, followed down to its minimum, or else the lowest value: unvoiced
+
+    int period = -1;
+
+    for (int tau = minPeriod; tau < maxPeriod; tau++)
+    {
+        if (difference[tau] < threshold)
+        {
+            while (tau + 1 < maxPeriod && difference[tau + 1] < difference[tau])
+            {
+                tau++;
+            }
+
+            period = tau;
+            break;
+        }
+    }
+
+    bool voiced = period > 0;
+
+    if (!voiced)
+    {
+        period = static_cast<int>(std::min_element(difference + minPeriod, difference + maxPeriod) - difference);
+    }
+
+    // Parabola through the minimum and its neighbours
+
+    double y0 = difference[period - 1];
+    double y1 = difference[period];
+    double y2 = difference[period + 1];
+
+    double curvature = y0 - 2.0 * y1 + y2;
+    double shift = curvature > 0 ? qBound(-0.5, 0.5 * (y0 - y2) / curvature, 0.5) : 0;
+
+    double minimum = y1 - 0.25 * (y0 - y2) * shift;
+    double periodicity = qBound(0.0, 1.0 - minimum, 1.0);
+
+    periodicityData[s] = periodicity;
+
+    Real *row = featureRows[static_cast<size_t>(s)];
+
+    if (voiced)
+    {
+        double frequency = sampleRate / (period + shift);
+
+        frequencyData[s] = frequency;
+        row[0] = static_cast<Real>(log2(frequency / minFrequency));
+    }
+
+    row[1] = static_cast<Real>(periodicity);
+}
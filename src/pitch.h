@@ -0,0 +1,75 @@
+#ifndef PITCH_H
+#define PITCH_H
+
+#include "precision.h"
+#include "fftPlanner.h"
+#include "matrix.h"
+#include "progress.h"
+#include "parallel.h"
+#include <QThread>
+#include <QVector>
+#include <vector>
+
+// Estimates the fundamental frequency of each segment of the FFT analysis with the YIN method.
+// The difference function is obtained from the autocorrelation, computed with FFTs in O(n log n) per segment,
+// and normalized by its cumulative mean. The first dip below the threshold gives the period, refined by
+// parabolic interpolation. Segments are shared out among a pool of workers.
+
+class Pitch : public QThread
+{
+    Q_OBJECT
+
+public:
+    Pitch(QObject *parent = nullptr);
+    ~Pitch() override;
+
+    int minFrequency;
+    int maxFrequency;
+    double threshold;
+
+    int segmentNumber;
+
+    // Per segment: center time, fundamental frequency (NaN if unvoiced) and periodicity, from 0 to 1
+    QVector<double> times;
+    QVector<double> frequencies;
+    QVector<double> periodicities;
+
+    // Per segment: octaves above the minimum frequency (0 if unvoiced) and periodicity, for clustering
+    Matrix<Real> features;
+
+    Progress progress;
+
+    void initData(const Real *receivedSamples, unsigned long receivedSampleNumber, int receivedSampleRate, int segmentMilliseconds, int segmentHopMilliseconds, double startTime);
+    void trackPitch();
+    void clearPitchData();
+
+signals:
+    void pitchPerformed();
+
+protected:
+    void run() override;
+
+private:
+    struct Workspace;
+
+    const Real *samples;
+    unsigned long sampleNumber;
+    int sampleRate;
+    int milliseconds;
+    int hopMilliseconds;
+    double minTime;
+
+    int nSamples;
+    int nHop;
+    int minPeriod;
+    int maxPeriod;
+
+    double *frequencyData;
+    double *periodicityData;
+    std::vector<Real*> featureRows;
+
+    void trackSegments(const FFTPlanner::CorrelationPlans &plans, Parallel::Items &items);
+    void trackSegment(int s, const FFTPlanner::CorrelationPlans &plans, Workspace &workspace);
+};
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef PRECISION_H
+#define PRECISION_H
+
+#include "fftw3.h"
+
+// Floating point type of samples, spectra and analysis data, and the matching FFTW API.
+// Single precision by default; add CONFIG += double_precision to the project to switch to double.
+// Reductions over many elements accumulate in double regardless.
+
+#ifdef DOUBLE_PRECISION
+typedef double Real;
+#define FFTW(name) fftw_ ## name
+#else
+typedef float Real;
+#define FFTW(name) fftwf_ ## name
+#endif
+
+#endif
@@ -0,0 +1,71 @@
+#include "progress.h"
+#include <algorithm>
+#include <chrono>
+
+Progress::Progress() : done(0), total(0), iterations(0), itemUnit(""), startTime(0), endTime(0)
+{
+}
+
+qint64 Progress::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Progress::start(qint64 newTotal, const char *newUnit)
+{
+    done = 0;
+    total = newTotal;
+    iterations = 0;
+    itemUnit = newUnit;
+    endTime = 0;
+    startTime = now();
+}
+
+void Progress::finish()
+{
+    endTime = now();
+}
+
+double Progress::elapsedSeconds() const
+{
+    qint64 end = endTime.load();
+
+    return ((end != 0 ? end : now()) - startTime.load()) / 1.0e9;
+}
+
+double Progress::fraction() const
+{
+    qint64 n = totalCount();
+
+    return n > 0 ? std::min(1.0, static_cast<double>(doneCount()) / n) : 0;
+}
+
+double Progress::rate() const
+{
+    // Items per second, or iterations per second for stages counting only iterations
+
+    double seconds = elapsedSeconds();
+    double count = totalCount() > 0 ? static_cast<double>(doneCount()) : iteration();
+
+    return seconds > 0 ? count / seconds : 0;
+}
+
+double Progress::remainingSeconds() const
+{
+    // At the mean rate so far, unknown (negative) before the first item or without a total
+
+    qint64 n = totalCount();
+    qint64 count = doneCount();
+
+    if (endTime.load() != 0)
+    {
+        return 0;
+    }
+
+    if (n <= 0 || count <= 0)
+    {
+        return -1;
+    }
+
+    return elapsedSeconds() * (n - count) / count;
+}
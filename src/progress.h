@@ -0,0 +1,46 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <QtGlobal>
+#include <atomic>
+
+// Progress of a worker stage, read by the GUI thread without signals.
+// Workers only update atomic counters, however many items they process, and the GUI polls them at its own rate.
+// Items done over the total, iterations for stages of unknown length, throughput and time left.
+
+class Progress
+{
+public:
+    Progress();
+
+    void start(qint64 newTotal, const char *newUnit);
+    void advance(qint64 count = 1) { done.fetch_add(count, std::memory_order_relaxed); }
+    void setDone(qint64 count) { done.store(count, std::memory_order_relaxed); }
+    void setIteration(int count) { iterations.store(count, std::memory_order_relaxed); }
+    void finish();
+
+    qint64 doneCount() const { return done.load(std::memory_order_relaxed); }
+    qint64 totalCount() const { return total.load(std::memory_order_relaxed); }
+    int iteration() const { return iterations.load(std::memory_order_relaxed); }
+    const char *unit() const { return itemUnit.load(); }
+    bool hasStarted() const { return startTime.load() != 0; }
+
+    double fraction() const;
+    double rate() const;
+    double remainingSeconds() const;
+
+private:
+    std::atomic<qint64> done;
+    std::atomic<qint64> total;
+    std::atomic<int> iterations;
+    std::atomic<const char*> itemUnit;
+
+    // Nanoseconds on a monotonic clock, end time zero while running
+    std::atomic<qint64> startTime;
+    std::atomic<qint64> endTime;
+
+    static qint64 now();
+    double elapsedSeconds() const;
+};
+
+#endif
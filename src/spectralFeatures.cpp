@@ -0,0 +1,251 @@
+#include "spectralFeatures.h"
+#include "laneSum.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+SpectralFeatures::SpectralFeatures(QObject *parent) : QThread(parent)
+{
+    nSegments = 0;
+    nFrequencies = 0;
+    frequencyStep = 1;
+}
+
+SpectralFeatures::~SpectralFeatures()
+{
+    quit();
+    requestInterruption();
+    wait();
+}
+
+void SpectralFeatures::initData(const Matrix<float> &receivedMagnitudes, double receivedFrequencyStep)
+{
+    magnitudes = receivedMagnitudes;
+    nSegments = receivedMagnitudes.rows();
+    nFrequencies = receivedMagnitudes.columns();
+    frequencyStep = receivedFrequencyStep;
+}
+
+void SpectralFeatures::computeFeatures()
+{
+    start();
+}
+
+void SpectralFeatures::clearFeaturesData()
+{
+    names.clear();
+    features.clear();
+}
+
+void SpectralFeatures::designBands()
+{
+    // Octaves centered at 62.5 Hz times powers of two, as far as the Nyquist frequency
+
+    bandFirsts.clear();
+    bandEnds.clear();
+
+    double nyquist = (nFrequencies - 1) * frequencyStep;
+
+    for (double center = 62.5; center * M_SQRT2 <= nyquist; center *= 2)
+    {
+        int first = std::max(1, static_cast<int>(ceil(center / M_SQRT2 / frequencyStep)));
+        int end = std::min(nFrequencies, static_cast<int>(ceil(center * M_SQRT2 / frequencyStep)));
+
+        if (end > first)
+        {
+            bandFirsts.push_back(first);
+            bandEnds.push_back(end);
+            names.push_back(QString("Energy %1 Hz").arg(center));
+        }
+    }
+}
+
+void SpectralFeatures::run()
+{
+    clearFeaturesData();
+
+    names << "Centroid" << "Spread" << "Flux" << "Rolloff" << "Flatness" << "Crest";
+
+    designBands();
+
+    progress.start(nSegments, "segments");
+
+    features = Matrix<Real>(nSegments, names.size());
+
+    std::vector<Real*> rows(static_cast<size_t>(nSegments));
+
+    for (int segment = 0; segment < nSegments; segment++)
+    {
+        rows[static_cast<size_t>(segment)] = features.mutableRow(segment);
+    }
+
+    Parallel::forEach(nSegments, [this](){ return isInterruptionRequested(); }, &progress, [this, &rows](int segment)
+    {
+        describe(segment, rows[static_cast<size_t>(segment)]);
+    });
+
+    progress.finish();
+
+    magnitudes.clear();
+
+    if (isInterruptionRequested())
+    {
+        clearFeaturesData();
+        return;
+    }
+
+    standardize();
+
+    emit(featuresPerformed());
+}
+
+void SpectralFeatures::describe(int segment, Real *row) const
+{
+    // Frequency indexes from 1, the DC component left out as in the spectra
+
+    const float *m = magnitudes.row(segment) + 1;
+    const float *previous = segment > 0 ? magnitudes.row(segment - 1) + 1 : m;
+
+    int n = nFrequencies - 1;
+
+    const double tiny = 1.0e-12;
+
+    if (n <= 0)
+    {
+        return;
+    }
+
+    // Moments of the magnitudes over frequency index, energy, peak and flux in one pass
+
+    double sum[sumLanes] = {};
+    double firstMoment[sumLanes] = {};
+    double secondMoment[sumLanes] = {};
+    double energy[sumLanes] = {};
+    double flux[sumLanes] = {};
+    float peak[sumLanes] = {};
+
+    int k = 0;
+
+    for (; k + sumLanes <= n; k += sumLanes)
+    {
+        for (int l = 0; l < sumLanes; l++)
+        {
+            double x = m[k + l];
+            double index = k + l + 1;
+            double difference = x - previous[k + l];
+
+            sum[l] += x;
+            firstMoment[l] += index * x;
+            secondMoment[l] += index * index * x;
+            energy[l] += x * x;
+            flux[l] += difference * difference;
+            peak[l] = std::max(peak[l], m[k + l]);
+        }
+    }
+
+    for (; k < n; k++)
+    {
+        double x = m[k];
+        double index = k + 1;
+        double difference = x - previous[k];
+
+        sum[0] += x;
+        firstMoment[0] += index * x;
+        secondMoment[0] += index * index * x;
+        energy[0] += x * x;
+        flux[0] += difference * difference;
+        peak[0] = std::max(peak[0], m[k]);
+    }
+
+    for (int l = 1; l < sumLanes; l++)
+    {
+        sum[0] += sum[l];
+        firstMoment[0] += firstMoment[l];
+        secondMoment[0] += secondMoment[l];
+        energy[0] += energy[l];
+        flux[0] += flux[l];
+        peak[0] = std::max(peak[0], peak[l]);
+    }
+
+    // Silence: no shape, the lowest band energies
+
+    if (sum[0] <= 0)
+    {
+        for (int b = 0; b < bandFirsts.size(); b++)
+        {
+            row[6 + b] = static_cast<Real>(log10(tiny));
+        }
+        return;
+    }
+
+    // Mean of the logarithms, for the geometric mean, in its own pass
+
+    double logSum = laneSum<double>(n, [m, tiny](int j){ return log(m[j] + tiny); });
+
+    double mean = sum[0] / n;
+    double centroid = firstMoment[0] / sum[0];
+    double variance = std::max(0.0, secondMoment[0] / sum[0] - centroid * centroid);
+
+    // Rolloff: frequency below which lies the given fraction of the energy
+
+    double threshold = rolloffFraction * energy[0];
+    double cumulative = 0;
+    int rolloff = 0;
+
+    while (rolloff < n - 1 && cumulative + static_cast<double>(m[rolloff]) * m[rolloff] < threshold)
+    {
+        cumulative += static_cast<double>(m[rolloff]) * m[rolloff];
+        rolloff++;
+    }
+
+    row[0] = static_cast<Real>(centroid * frequencyStep);
+    row[1] = static_cast<Real>(sqrt(variance) * frequencyStep);
+    row[2] = static_cast<Real>(sqrt(flux[0]));
+    row[3] = static_cast<Real>((rolloff + 1) * frequencyStep);
+    row[4] = static_cast<Real>(exp(logSum / n) / mean);
+    row[5] = static_cast<Real>(peak[0] / mean);
+
+    // Octave band energies, logarithmic
+
+    for (int b = 0; b < bandFirsts.size(); b++)
+    {
+        const float *band = m + bandFirsts[b] - 1;
+        int nBand = bandEnds[b] - bandFirsts[b];
+
+        double bandEnergy = laneSum<double>(nBand, [band](int j){ return static_cast<double>(band[j]) * band[j]; });
+
+        row[6 + b] = static_cast<Real>(log10(bandEnergy + tiny));
+    }
+}
+
+void SpectralFeatures::standardize()
+{
+    // Zero mean and unit variance per column, constant columns left at zero
+
+    int nColumns = features.columns();
+
+    for (int col = 0; col < nColumns; col++)
+    {
+        double sum = 0;
+        double squares = 0;
+
+        for (int row = 0; row < nSegments; row++)
+        {
+            double x = features.at(row, col);
+
+            sum += x;
+            squares += x * x;
+        }
+
+        double mean = sum / nSegments;
+        double deviation = sqrt(std::max(0.0, squares / nSegments - mean * mean));
+
+        for (int row = 0; row < nSegments; row++)
+        {
+            Real *x = features.mutableRow(row) + col;
+
+            *x = deviation > 0 ? static_cast<Real>((*x - mean) / deviation) : 0;
+        }
+    }
+}
@@ -0,0 +1,184 @@
+#include "waveFormPlottable.h"
+
+WaveFormPlottable::WaveFormPlottable(QCPAxis *keyAxis, QCPAxis *valueAxis) : QCPAbstractPlottable(keyAxis, valueAxis)
+{
+    samples = nullptr;
+    sampleNumber = 0;
+    sampleRate = 1;
+    minValue = 0;
+    maxValue = 0;
+    startTime = 0;
+
+    setPen(QPen(Qt::blue, 0));
+    setBrush(Qt::NoBrush);
+}
+
+void WaveFormPlottable::setData(const Real *samples, int sampleNumber, double sampleRate, double minValue, double maxValue, double startTime)
+{
+    this->samples = samples;
+    this->sampleNumber = sampleNumber;
+    this->sampleRate = sampleRate;
+    this->minValue = minValue;
+    this->maxValue = maxValue;
+    this->startTime = startTime;
+}
+
+void WaveFormPlottable::clearData()
+{
+    samples = nullptr;
+    sampleNumber = 0;
+}
+
+int WaveFormPlottable::dataCount() const
+{
+    return samples == nullptr ? 0 : sampleNumber;
+}
+
+double WaveFormPlottable::keyAt(int index) const
+{
+    return startTime + index / sampleRate;
+}
+
+int WaveFormPlottable::indexAt(double key) const
+{
+    return static_cast<int>(qBound(0.0, (key - startTime) * sampleRate, static_cast<double>(sampleNumber - 1)));
+}
+
+double WaveFormPlottable::selectTest(const QPointF &pos, bool onlySelectable, QVariant *details) const
+{
+    Q_UNUSED(details)
+
+    if ((onlySelectable && mSelectable == QCP::stNone) || dataCount() == 0)
+    {
+        return -1;
+    }
+    if (!mKeyAxis || !mValueAxis)
+    {
+        return -1;
+    }
+
+    double posKey, posValue;
+    pixelsToCoords(pos, posKey, posValue);
+
+    int index = indexAt(posKey);
+
+    return QCPVector2D(coordsToPixels(keyAt(index), samples[index]) - pos).length();
+}
+
+QCPRange WaveFormPlottable::getKeyRange(bool &foundRange, QCP::SignDomain inSignDomain) const
+{
+    foundRange = dataCount() > 0;
+
+    QCPRange range(keyAt(0), keyAt(sampleNumber - 1));
+
+    if (inSignDomain == QCP::sdPositive && range.upper <= 0)
+    {
+        foundRange = false;
+    }
+    else if (inSignDomain == QCP::sdNegative && range.lower >= 0)
+    {
+        foundRange = false;
+    }
+
+    return range;
+}
+
+QCPRange WaveFormPlottable::getValueRange(bool &foundRange, QCP::SignDomain inSignDomain, const QCPRange &inKeyRange) const
+{
+    Q_UNUSED(inKeyRange)
+
+    foundRange = dataCount() > 0;
+
+    QCPRange range(minValue, maxValue);
+
+    if (inSignDomain == QCP::sdPositive && range.upper <= 0)
+    {
+        foundRange = false;
+    }
+    else if (inSignDomain == QCP::sdNegative && range.lower >= 0)
+    {
+        foundRange = false;
+    }
+
+    return range;
+}
+
+void WaveFormPlottable::draw(QCPPainter *painter)
+{
+    if (!mKeyAxis || !mValueAxis || dataCount() == 0)
+    {
+        return;
+    }
+
+    QCPAxis *keyAxis = mKeyAxis.data();
+
+    if (keyAxis->range().size() <= 0)
+    {
+        return;
+    }
+
+    // Visible samples, extended by one on each side so lines reach the axis rect borders
+
+    int begin = qMax(0, indexAt(keyAxis->range().lower) - 1);
+    int end = qMin(sampleNumber, indexAt(keyAxis->range().upper) + 2);
+    int count = end - begin;
+
+    int pixels = qMax(1, static_cast<int>(qAbs(keyAxis->coordToPixel(keyAt(end - 1)) - keyAxis->coordToPixel(keyAt(begin)))));
+
+    applyDefaultAntialiasingHint(painter);
+    painter->setPen(mPen);
+    painter->setBrush(Qt::NoBrush);
+
+    if (count > 2 * pixels)
+    {
+        // More samples than pixels: one vertical min/max line per pixel column
+        // Each column also covers the last sample of the previous one so that columns join
+
+        QVector<QLineF> lines;
+        lines.reserve(pixels);
+
+        for (int p = 0; p < pixels; p++)
+        {
+            int i0 = begin + static_cast<int>(static_cast<qint64>(count) * p / pixels);
+            int i1 = begin + static_cast<int>(static_cast<qint64>(count) * (p + 1) / pixels);
+
+            double min = static_cast<double>(samples[qMax(begin, i0 - 1)]);
+            double max = min;
+
+            for (int i = i0; i < i1; i++)
+            {
+                if (samples[i] < min)
+                {
+                    min = samples[i];
+                }
+                if (samples[i] > max)
+                {
+                    max = samples[i];
+                }
+            }
+
+            double key = keyAt(i0);
+            lines.push_back(QLineF(coordsToPixels(key, min), coordsToPixels(key, max)));
+        }
+
+        painter->drawLines(lines);
+    }
+    else
+    {
+        QPolygonF polyline(count);
+
+        for (int i = 0; i < count; i++)
+        {
+            polyline[i] = coordsToPixels(keyAt(begin + i), samples[begin + i]);
+        }
+
+        painter->drawPolyline(polyline);
+    }
+}
+
+void WaveFormPlottable::drawLegendIcon(QCPPainter *painter, const QRectF &rect) const
+{
+    applyDefaultAntialiasingHint(painter);
+    painter->setPen(mPen);
+    painter->drawLine(QLineF(rect.left(), rect.top() + rect.height() / 2.0, rect.right() + 5, rect.top() + rect.height() / 2.0));
+}
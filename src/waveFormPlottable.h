@@ -0,0 +1,41 @@
+#ifndef WAVEFORMPLOTTABLE_H
+#define WAVEFORMPLOTTABLE_H
+
+#include "precision.h"
+#include "qcustomplot.h"
+
+// Plots evenly sampled data without storing keys: the time of sample i is derived
+// as startTime + i / sampleRate. Samples are not copied and must outlive the plottable's data.
+
+class WaveFormPlottable : public QCPAbstractPlottable
+{
+    Q_OBJECT
+
+public:
+    WaveFormPlottable(QCPAxis *keyAxis, QCPAxis *valueAxis);
+
+    void setData(const Real *samples, int sampleNumber, double sampleRate, double minValue, double maxValue, double startTime = 0);
+    void clearData();
+    int dataCount() const;
+
+    double selectTest(const QPointF &pos, bool onlySelectable, QVariant *details = nullptr) const override;
+    QCPRange getKeyRange(bool &foundRange, QCP::SignDomain inSignDomain = QCP::sdBoth) const override;
+    QCPRange getValueRange(bool &foundRange, QCP::SignDomain inSignDomain = QCP::sdBoth, const QCPRange &inKeyRange = QCPRange()) const override;
+
+protected:
+    void draw(QCPPainter *painter) override;
+    void drawLegendIcon(QCPPainter *painter, const QRectF &rect) const override;
+
+private:
+    const Real *samples;
+    int sampleNumber;
+    double sampleRate;
+    double minValue;
+    double maxValue;
+    double startTime;
+
+    double keyAt(int index) const;
+    int indexAt(double key) const;
+};
+
+#endif